@@ -4,6 +4,7 @@
 
 import sys
 import os
+import subprocess
 
 sys.path.insert(0, os.path.join('build', 'ninja'))
 
@@ -16,8 +17,54 @@ target = generator.target
 writer = generator.writer
 toolchain = generator.toolchain
 
+#Native Wayland backend is built when wayland-client is available, selected at runtime
+use_wayland = False
+if target.is_linux():
+  try:
+    use_wayland = subprocess.call(['pkg-config', '--exists', 'wayland-client']) == 0
+  except OSError:
+    use_wayland = False
+
+#XInput2 precise and raw pointer input is built when libXi is available
+use_xinput2 = False
+if target.is_linux():
+  try:
+    use_xinput2 = subprocess.call(['pkg-config', '--exists', 'xi']) == 0
+  except OSError:
+    use_xinput2 = False
+
+#XRandR monitor enumeration is built when libXrandr is available
+use_xrandr = False
+if target.is_linux():
+  try:
+    use_xrandr = subprocess.call(['pkg-config', '--exists', 'xrandr']) == 0
+  except OSError:
+    use_xrandr = False
+
+window_defines = []
+if use_wayland:
+  window_defines += ['WINDOW_ENABLE_WAYLAND=1']
+if use_xinput2:
+  window_defines += ['WINDOW_ENABLE_XINPUT2=1']
+if use_xrandr:
+  window_defines += ['WINDOW_ENABLE_XRANDR=1']
+window_variables = None
+if window_defines:
+  window_variables = {'defines': window_defines}
+
+#Outputs built by default, everything except the targets running binaries
+default_targets = []
+def add_default(built):
+  if isinstance(built, dict):
+    for config in built:
+      default_targets.extend(built[config])
+  else:
+    default_targets.extend(built)
+  return built
+
 window_lib = generator.lib(module = 'window', sources = [
-  'event.c', 'version.c', 'window.c', 'window_android.c', 'window_ios.m', 'window_linux.c', 'window_macos.m', 'window_windows.c'])
+  'event.c', 'version.c', 'window.c', 'window_android.c', 'window_ios.m', 'window_linux.c', 'window_macos.m', 'window_wayland.c', 'window_windows.c'], variables = window_variables)
+add_default(window_lib)
 
 #No test cases if we're a submodule
 if generator.is_subninja():
@@ -35,11 +82,18 @@ if target.is_windows():
   gllibs = ['gdi32']
 if target.is_linux():
   gllibs = ['GL', 'Xext', 'X11']
+  if use_wayland:
+    gllibs += ['wayland-client']
+  if use_xinput2:
+    gllibs = ['Xi'] + gllibs
+  if use_xrandr:
+    gllibs = ['Xrandr'] + gllibs
   print("GLlibs: " + str(gllibs))
 
 test_cases = [
   'window'
 ]
+test_bins = {}
 if toolchain.is_monolithic() or target.is_ios() or target.is_android() or target.is_tizen():
   #Build one fat binary with all test cases
   test_resources = []
@@ -62,15 +116,41 @@ if toolchain.is_monolithic() or target.is_ios() or target.is_android() or target
       'tizen-manifest.xml', os.path.join( 'res', 'tizenapp.png')
     ]]
   if target.is_macos() or target.is_ios() or target.is_android() or target.is_tizen():
-    generator.app(module = '', sources = [os.path.join(module, 'main.c') for module in test_cases] + test_extrasources, binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths)
+    add_default(generator.app(module = '', sources = [os.path.join(module, 'main.c') for module in test_cases] + test_extrasources, binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths))
   else:
-    generator.bin(module = '', sources = [os.path.join(module, 'main.c') for module in test_cases] + test_extrasources, binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths)
+    add_default(generator.bin(module = '', sources = [os.path.join(module, 'main.c') for module in test_cases] + test_extrasources, binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths))
 else:
   #Build one binary per test case
-  generator.bin(module = 'all', sources = ['main.c'], binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = dependlibs + gllibs, includepaths = includepaths)
+  add_default(generator.bin(module = 'all', sources = ['main.c'], binname = 'test-all', basepath = 'test', implicit_deps = [window_lib], libs = dependlibs + gllibs, includepaths = includepaths))
   for test in test_cases:
     if target.is_macos():
       test_resources = [os.path.join('macos', item) for item in ['test-' + test + '.plist', 'test-' + test + '.entitlements', 'Images.xcassets', 'test-' + test + '.xib']]
-      generator.app(module = test, sources = ['main.c'], binname = 'test-' + test, basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths)
+      add_default(generator.app(module = test, sources = ['main.c'], binname = 'test-' + test, basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, resources = test_resources, includepaths = includepaths))
     else:
-      generator.bin(module = test, sources = ['main.c'], binname = 'test-' + test, basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, includepaths = includepaths)
+      test_bins[test] = add_default(generator.bin(module = test, sources = ['main.c'], binname = 'test-' + test, basepath = 'test', implicit_deps = [window_lib], libs = ['test'] + dependlibs + gllibs, frameworks = glframeworks, includepaths = includepaths))
+
+#Benchmark suite and input injection harness, not named test-* so the test launcher does not pick them up
+bench_bin = {}
+if target.is_linux():
+  bench_bin = add_default(generator.bin(module = 'bench', sources = ['main.c'], binname = 'bench-window', basepath = 'test', implicit_deps = [window_lib], libs = dependlibs + gllibs, includepaths = includepaths, variables = window_variables))
+  add_default(generator.bin(module = 'inject', sources = ['main.c'], binname = 'inject-window', basepath = 'test', implicit_deps = [window_lib], libs = dependlibs + ['Xtst'] + gllibs, includepaths = includepaths))
+
+#Tests and benchmark under a headless Weston compositor, once on the native Wayland backend and once on the X11
+#backend through Xwayland, to compare the two. Not built by default, run with "ninja test-weston" and
+#"ninja bench-weston", benchmark results are written next to the binary as bench-window-<backend>.json
+if target.is_linux() and use_wayland and 'window' in test_bins:
+  writer.default(default_targets)
+  writer.newline()
+  writer.rule('weston', command = sys.executable + ' ' + os.path.join('test', 'weston.py') + ' $backend $in $args', description = 'WESTON $backend $in', pool = 'console')
+  weston_tests = []
+  weston_benches = []
+  for config in test_bins['window']:
+    for backend in ['wayland', 'x11']:
+      for binary in test_bins['window'][config]:
+        weston_tests += writer.build(binary + '-weston-' + backend, 'weston', binary, variables = {'backend': backend})
+      for binary in bench_bin.get(config, []):
+        result = os.path.join(os.path.dirname(binary), 'bench-window-' + backend + '.json')
+        weston_benches += writer.build(result, 'weston', binary, variables = {'backend': backend, 'args': '--output ' + result})
+  writer.build('test-weston', 'phony', weston_tests)
+  writer.build('bench-weston', 'phony', weston_benches)
+  writer.newline()
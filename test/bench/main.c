@@ -0,0 +1,1029 @@
+/* main.c  -  Window benchmark  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform window library in C11 providing basic support data types
+ * and functions to create and manage windows in a platform-independent fashion. The latest source
+ * code is always available at
+ *
+ * https://github.com/mjansson/window_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any
+ * restrictions.
+ *
+ */
+
+#include <foundation/foundation.h>
+#include <window/window.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#if WINDOW_ENABLE_WAYLAND
+#include <wayland-client.h>
+#endif
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Results are written as one JSON object per line, see bench_report and bench_report_rate
+
+static FILE* bench_output;
+static unsigned int bench_iterations = 100;
+static unsigned int bench_window_counts[8] = {1, 10, 100, 1000};
+static size_t bench_window_count_size = 4;
+static size_t bench_pool_capacity;
+static thread_t bench_loop_thread;
+
+// Allocation counting wrapper around the malloc memory system, see bench_allocations
+static memory_system_t bench_memory_base;
+static atomic64_t bench_memory_allocations;
+
+static void*
+bench_memory_allocate(hash_t context, size_t size, unsigned int align, unsigned int hint) {
+	atomic_add64(&bench_memory_allocations, 1, memory_order_relaxed);
+	return bench_memory_base.allocate(context, size, align, hint);
+}
+
+static void*
+bench_memory_reallocate(void* p, size_t size, unsigned int align, size_t oldsize, unsigned int hint) {
+	atomic_add64(&bench_memory_allocations, 1, memory_order_relaxed);
+	return bench_memory_base.reallocate(p, size, align, oldsize, hint);
+}
+
+static memory_system_t
+bench_memory_system(void) {
+	memory_system_t system = bench_memory_base = memory_system_malloc();
+	system.allocate = bench_memory_allocate;
+	system.reallocate = bench_memory_reallocate;
+	return system;
+}
+
+static int64_t
+bench_allocations(void) {
+	return atomic_load64(&bench_memory_allocations, memory_order_relaxed);
+}
+
+// Hardware cache miss counter for the calling thread, -1 if not available (no permission or virtualized)
+static int
+bench_cache_misses_open(void) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void
+bench_cache_misses_start(int fd) {
+	if (fd < 0)
+		return;
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static long long
+bench_cache_misses_stop(int fd) {
+	long long count = -1;
+	if (fd < 0)
+		return count;
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		count = -1;
+	return count;
+}
+
+typedef struct bench_samples_t bench_samples_t;
+
+struct bench_samples_t {
+	tick_t* sample;
+	size_t count;
+	size_t capacity;
+};
+
+static void
+bench_samples_initialize(bench_samples_t* samples, size_t capacity) {
+	samples->sample = memory_allocate(HASH_WINDOW, sizeof(tick_t) * capacity, 0, MEMORY_PERSISTENT);
+	samples->count = 0;
+	samples->capacity = capacity;
+}
+
+static void
+bench_samples_finalize(bench_samples_t* samples) {
+	memory_deallocate(samples->sample);
+	samples->sample = 0;
+}
+
+static void
+bench_samples_add(bench_samples_t* samples, tick_t ticks) {
+	if (samples->count < samples->capacity)
+		samples->sample[samples->count++] = ticks;
+}
+
+static int
+bench_tick_compare(const void* lhs, const void* rhs) {
+	tick_t a = *(const tick_t*)lhs;
+	tick_t b = *(const tick_t*)rhs;
+	return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+static double
+bench_microseconds(tick_t ticks) {
+	return ((double)ticks * 1000000.0) / (double)time_ticks_per_second();
+}
+
+static void
+bench_report(const char* name, unsigned int windows, bench_samples_t* samples) {
+	if (!samples->count) {
+		fprintf(bench_output, "{\"benchmark\":\"%s\",\"windows\":%u,\"samples\":0}\n", name, windows);
+		return;
+	}
+	qsort(samples->sample, samples->count, sizeof(tick_t), bench_tick_compare);
+	tick_t total = 0;
+	for (size_t isample = 0; isample < samples->count; ++isample)
+		total += samples->sample[isample];
+	size_t last = samples->count - 1;
+	fprintf(bench_output,
+	        "{\"benchmark\":\"%s\",\"windows\":%u,\"samples\":%u,\"min_us\":%.3f,\"mean_us\":%.3f,\"p50_us\":%.3f,"
+	        "\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}\n",
+	        name, windows, (unsigned int)samples->count, bench_microseconds(samples->sample[0]),
+	        bench_microseconds(total) / (double)samples->count, bench_microseconds(samples->sample[last / 2]),
+	        bench_microseconds(samples->sample[(last * 90) / 100]), bench_microseconds(samples->sample[(last * 99) / 100]),
+	        bench_microseconds(samples->sample[last]));
+	fflush(bench_output);
+	samples->count = 0;
+}
+
+static void
+bench_report_rate(const char* name, unsigned int windows, size_t count, tick_t ticks) {
+	double seconds = (double)ticks / (double)time_ticks_per_second();
+	fprintf(bench_output,
+	        "{\"benchmark\":\"%s\",\"windows\":%u,\"events\":%u,\"seconds\":%.6f,\"events_per_second\":%.1f}\n", name,
+	        windows, (unsigned int)count, seconds, (seconds > 0) ? ((double)count / seconds) : 0.0);
+	fflush(bench_output);
+}
+
+static void
+bench_report_stats(void) {
+#if WINDOW_ENABLE_STATISTICS
+	static const char* call_name[WINDOW_STATS_CALL_COUNT] = {
+	    "create",       "finalize",     "maximize",  "minimize", "restore",    "resize",     "move",        "is_maximized",
+	    "is_minimized", "has_focus",    "width",     "height",   "position_x", "position_y", "message_quit"};
+	static const char* lock_name[WINDOW_STATS_LOCK_COUNT] = {"display", "window_list"};
+	window_stats_t stats;
+	window_stats_get(&stats);
+	for (size_t icall = 0; icall < WINDOW_STATS_CALL_COUNT; ++icall) {
+		if (!stats.calls[icall])
+			continue;
+		fprintf(bench_output, "{\"stats\":\"call\",\"call\":\"%s\",\"calls\":%llu,\"roundtrips_per_call\":%.2f}\n",
+		        call_name[icall], (unsigned long long)stats.calls[icall],
+		        (double)stats.roundtrips[icall] / (double)stats.calls[icall]);
+	}
+	for (size_t ilock = 0; ilock < WINDOW_STATS_LOCK_COUNT; ++ilock) {
+		fprintf(bench_output,
+		        "{\"stats\":\"lock\",\"lock\":\"%s\",\"count\":%llu,\"wait_us\":%.3f,\"wait_max_us\":%.3f,"
+		        "\"hold_us\":%.3f,\"hold_max_us\":%.3f}\n",
+		        lock_name[ilock], (unsigned long long)stats.lock_count[ilock], bench_microseconds(stats.lock_wait[ilock]),
+		        bench_microseconds(stats.lock_wait_max[ilock]), bench_microseconds(stats.lock_hold[ilock]),
+		        bench_microseconds(stats.lock_hold_max[ilock]));
+	}
+	fprintf(bench_output,
+	        "{\"stats\":\"loop\",\"wakeups\":%llu,\"events\":%llu,\"events_max\":%llu,\"process_us\":%.3f}\n",
+	        (unsigned long long)stats.loop_wakeups, (unsigned long long)stats.loop_events,
+	        (unsigned long long)stats.loop_events_max, bench_microseconds(stats.loop_time));
+	fflush(bench_output);
+#endif
+}
+
+static void
+bench_drain(void) {
+	event_block_t* block = event_stream_process(window_event_stream());
+	FOUNDATION_UNUSED(block);
+}
+
+//! Wait for the given event for the given window, returning the time it was seen or 0 on timeout
+static tick_t
+bench_wait_event(const window_t* window, int id, unsigned int timeout_ms) {
+	tick_t start = time_current();
+	tick_t limit = (time_ticks_per_second() * timeout_ms) / 1000;
+	do {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if ((event->id == id) && (window_event_window(event) == window))
+				return time_current();
+		}
+		thread_yield();
+	} while (time_elapsed_ticks(start) < limit);
+	return 0;
+}
+
+static void*
+bench_loop(void* arg) {
+	FOUNDATION_UNUSED(arg);
+	window_message_loop();
+	return 0;
+}
+
+static void
+bench_create(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		tick_t start = time_current();
+		windows[iwin] = window_allocate();
+		window_create(windows[iwin], WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window benchmark"), 320, 240, 0);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("create", count, samples);
+}
+
+static void
+bench_create_async(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Requests are queued without round trips, completion is signaled by the CREATE event on map
+	bench_drain();
+	tick_t start = time_current();
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		tick_t call_start = time_current();
+		windows[iwin] = window_allocate();
+		window_create_async(windows[iwin], WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window benchmark"), 320, 240, 0);
+		bench_samples_add(samples, time_elapsed_ticks(call_start));
+	}
+	bench_report("create_async_call", count, samples);
+
+	unsigned int created = 0;
+	while ((created < count) && (time_elapsed_ticks(start) < time_ticks_per_second() * 10)) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (event->id == WINDOWEVENT_CREATE)
+				++created;
+		}
+		thread_yield();
+	}
+	bench_report_rate("create_async_complete", count, created, time_elapsed_ticks(start));
+
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		window_deallocate(windows[iwin]);
+		windows[iwin] = 0;
+	}
+	bench_drain();
+}
+
+static void
+bench_create_batch(window_t** windows, unsigned int count) {
+	window_create_info_t* infos = memory_allocate(HASH_WINDOW, sizeof(window_create_info_t) * count, 0,
+	                                              MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		infos[iwin].adapter = WINDOW_ADAPTER_DEFAULT;
+		infos[iwin].title = "Window benchmark";
+		infos[iwin].length = 16;
+		infos[iwin].width = 320;
+		infos[iwin].height = 240;
+	}
+
+	// Time to all mapped, mapping is signaled by the SHOW event
+	bench_drain();
+	tick_t start = time_current();
+	size_t created = window_create_batch(infos, count, windows);
+	tick_t call = time_elapsed_ticks(start);
+	unsigned int mapped = 0;
+	while ((mapped < created) && (time_elapsed_ticks(start) < time_ticks_per_second() * 10)) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (event->id == WINDOWEVENT_SHOW)
+				++mapped;
+		}
+		thread_yield();
+	}
+	bench_report_rate("create_batch_call", count, created, call);
+	bench_report_rate("create_batch_mapped", count, mapped, time_elapsed_ticks(start));
+
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		if (windows[iwin])
+			window_deallocate(windows[iwin]);
+		windows[iwin] = 0;
+	}
+	bench_drain();
+	memory_deallocate(infos);
+}
+
+static void
+bench_create_child(window_t* parent, window_t** windows, unsigned int count, bench_samples_t* samples) {
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		tick_t start = time_current();
+		windows[iwin] = window_create_child(parent, (int)(iwin % 16) * 4, (int)(iwin / 16) * 4, 32, 32, 0);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("create_child", count, samples);
+
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		if (windows[iwin])
+			window_deallocate(windows[iwin]);
+		windows[iwin] = 0;
+	}
+	bench_drain();
+}
+
+static void
+bench_destroy(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		tick_t start = time_current();
+		window_deallocate(windows[iwin]);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+		windows[iwin] = 0;
+	}
+	bench_drain();
+	bench_report("destroy", count, samples);
+}
+
+static void
+bench_getters(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	unsigned int sink = 0;
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		sink += window_width(windows[iter % count]);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("window_width", count, samples);
+
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		sink += (unsigned int)window_position_x(windows[iter % count]);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("window_position_x", count, samples);
+
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		sink += window_is_maximized(windows[iter % count]) ? 1 : 0;
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("window_is_maximized", count, samples);
+
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		sink += window_has_focus(windows[iter % count]) ? 1 : 0;
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("window_has_focus", count, samples);
+
+	window_monitor_t monitors[4];
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		sink += (unsigned int)window_monitors(monitors, 4);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	bench_report("window_monitors", count, samples);
+
+	FOUNDATION_UNUSED(sink);
+}
+
+static void
+bench_sizemove(window_t** windows, unsigned int count, bench_samples_t* samples, bool move) {
+	bench_drain();
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		window_t* window = windows[iter % count];
+		tick_t start = time_current();
+		window_resize(window, 320 + (int)(((iter / count) + 1) & 1) * 16, 240);
+		tick_t seen = bench_wait_event(window, WINDOWEVENT_RESIZE, 1000);
+		if (seen)
+			bench_samples_add(samples, seen - start);
+	}
+	// Wayland toplevels resize without asking the compositor, the RESIZE only waits for the loop to apply it
+	bench_report(move ? "resize_roundtrip" : "resize_apply", count, samples);
+
+	if (!move)
+		return;
+
+	// Moves are reported through the same ConfigureNotify path as resizes
+	bench_drain();
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		window_t* window = windows[iter % count];
+		tick_t start = time_current();
+		window_move(window, 10 + (int)(((iter / count) + 1) & 1) * 16, 10);
+		tick_t seen = bench_wait_event(window, WINDOWEVENT_RESIZE, 1000);
+		if (seen)
+			bench_samples_add(samples, seen - start);
+	}
+	bench_report("move_roundtrip", count, samples);
+}
+
+static void
+bench_event_post(window_t** windows, unsigned int count) {
+	// Library side posting and consumption, independent of the windowing system
+	const size_t total = 64 * 1024;
+	bench_drain();
+	tick_t start = time_current();
+	size_t received = 0;
+	for (size_t ievent = 0; ievent < total; ++ievent) {
+		window_event_post(WINDOWEVENT_REDRAW, windows[ievent % count]);
+		if ((ievent & 63) == 63) {
+			event_block_t* block = event_stream_process(window_event_stream());
+			event_t* event = 0;
+			while ((event = event_next(block, event)))
+				++received;
+		}
+	}
+	bench_report_rate("event_post_throughput", count, received, time_elapsed_ticks(start));
+}
+
+static void
+bench_event_ring(window_t** windows, unsigned int count) {
+	// Same pattern as bench_event_post through a typed event ring with zero copy bulk drain
+	const size_t total = 64 * 1024;
+	window_event_ring_t* ring = window_event_ring_allocate(1024);
+	tick_t start = time_current();
+	size_t received = 0;
+	for (size_t ievent = 0; ievent < total; ++ievent) {
+		window_event_ring_write(ring, WINDOWEVENT_REDRAW, windows[ievent % count], 0, 0);
+		if ((ievent & 63) == 63) {
+			window_event_record_t* records;
+			size_t acquired;
+			while ((acquired = window_event_ring_acquire(ring, &records, 64))) {
+				received += acquired;
+				window_event_ring_release(ring, acquired);
+			}
+		}
+	}
+	bench_report_rate("event_ring_throughput", count, received, time_elapsed_ticks(start));
+	window_event_ring_deallocate(ring);
+}
+
+typedef struct bench_producer_t bench_producer_t;
+
+struct bench_producer_t {
+	window_event_ring_t* ring;
+	event_stream_t* stream;
+	window_t* window;
+	size_t count;
+};
+
+static void*
+bench_producer(void* arg) {
+	bench_producer_t* producer = arg;
+	for (size_t ievent = 0; ievent < producer->count; ++ievent) {
+		tick_t now = time_current();
+		if (producer->ring) {
+			while (!window_event_ring_write(producer->ring, WINDOWEVENT_REDRAW, producer->window, &now, sizeof(now)))
+				thread_yield();
+		} else {
+			event_post(producer->stream, WINDOWEVENT_REDRAW, 0, 0, &now, sizeof(now));
+		}
+		// Pace in bursts like a message loop draining the display connection
+		if ((ievent & 63) == 63)
+			thread_yield();
+	}
+	return 0;
+}
+
+static void
+bench_event_cross_thread(window_t* window, bench_samples_t* samples, bool ring) {
+	// Producer on a separate thread, posting timestamps, consumer measures latency per event
+	bench_producer_t producer;
+	memset(&producer, 0, sizeof(producer));
+	producer.window = window;
+	producer.count = samples->capacity;
+	if (ring)
+		producer.ring = window_event_ring_allocate(4096);
+	else
+		producer.stream = event_stream_allocate(4096);
+
+	thread_t thread;
+	thread_initialize(&thread, bench_producer, &producer, STRING_CONST("bench_producer"), THREAD_PRIORITY_NORMAL, 0);
+	tick_t start = time_current();
+	thread_start(&thread);
+
+	size_t received = 0;
+	while ((received < producer.count) && (time_elapsed_ticks(start) < time_ticks_per_second() * 10)) {
+		tick_t now = time_current();
+		if (ring) {
+			window_event_record_t* records;
+			size_t acquired = window_event_ring_acquire(producer.ring, &records, 256);
+			for (size_t irecord = 0; irecord < acquired; ++irecord)
+				bench_samples_add(samples, now - records[irecord].timestamp);
+			window_event_ring_release(producer.ring, acquired);
+			received += acquired;
+			if (!acquired)
+				thread_yield();
+		} else {
+			event_block_t* block = event_stream_process(producer.stream);
+			event_t* event = 0;
+			size_t processed = 0;
+			while ((event = event_next(block, event))) {
+				tick_t posted;
+				memcpy(&posted, event->payload, sizeof(posted));
+				bench_samples_add(samples, now - posted);
+				++processed;
+			}
+			received += processed;
+			if (!processed)
+				thread_yield();
+		}
+	}
+	tick_t elapsed = time_elapsed_ticks(start);
+
+	thread_join(&thread);
+	thread_finalize(&thread);
+
+	bench_report_rate(ring ? "event_ring_cross_thread_throughput" : "event_stream_cross_thread_throughput", 1, received,
+	                  elapsed);
+	bench_report(ring ? "event_ring_cross_thread_latency" : "event_stream_cross_thread_latency", 1, samples);
+
+	if (ring)
+		window_event_ring_deallocate(producer.ring);
+	else
+		event_stream_deallocate(producer.stream);
+}
+
+static void
+bench_event_native(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Full path: client message through the X server, message loop, event stream and consumer
+	Display* display = window_display(windows[0]);
+	Atom atom_bench = XInternAtom(display, "WINDOW_BENCH", False);
+	const unsigned int burst = 64;
+	unsigned int bursts = (bench_iterations > 16) ? bench_iterations / 4 : 4;
+	size_t consumed = 0;
+
+	bench_drain();
+	tick_t start = time_current();
+	for (unsigned int iburst = 0; iburst < bursts; ++iburst) {
+		XLockDisplay(display);
+		for (unsigned int isend = 0; isend < burst; ++isend) {
+			window_t* window = windows[(iburst * burst + isend) % count];
+			XEvent xevent;
+			memset(&xevent, 0, sizeof(xevent));
+			xevent.xclient.type = ClientMessage;
+			xevent.xclient.window = (Window)window_drawable(window);
+			xevent.xclient.message_type = atom_bench;
+			xevent.xclient.format = 32;
+			xevent.xclient.data.l[1] = (long)time_current();
+			XSendEvent(display, xevent.xclient.window, False, NoEventMask, &xevent);
+		}
+		XFlush(display);
+		XUnlockDisplay(display);
+
+		unsigned int matched = 0;
+		tick_t wait_start = time_current();
+		while ((matched < burst) && (time_elapsed_ticks(wait_start) < time_ticks_per_second())) {
+			event_block_t* block = event_stream_process(window_event_stream());
+			event_t* event = 0;
+			tick_t now = time_current();
+			while ((event = event_next(block, event))) {
+				++consumed;
+				if (event->id != WINDOWEVENT_NATIVE)
+					continue;
+				const XEvent* native = (const XEvent*)(const void*)(event->payload + sizeof(window_t*));
+				if ((native->type != ClientMessage) || (native->xclient.message_type != atom_bench))
+					continue;
+				bench_samples_add(samples, now - (tick_t)native->xclient.data.l[1]);
+				++matched;
+			}
+			thread_yield();
+		}
+	}
+	bench_report_rate("event_native_throughput", count, consumed, time_elapsed_ticks(start));
+	bench_report("event_native_latency", count, samples);
+}
+
+#if WINDOW_ENABLE_WAYLAND
+
+typedef struct bench_sync_t {
+	window_t* window;
+	tick_t sent;
+} bench_sync_t;
+
+static void
+bench_sync_done(void* data, struct wl_callback* callback, uint32_t serial) {
+	bench_sync_t* sync = data;
+	FOUNDATION_UNUSED(serial);
+	wl_callback_destroy(callback);
+	// Dispatched by the message loop thread like any compositor event
+	window_event_post_payload(WINDOWEVENT_NATIVE, sync->window, &sync->sent, sizeof(sync->sent));
+}
+
+static const struct wl_callback_listener bench_sync_listener = {bench_sync_done};
+
+static void
+bench_event_wayland(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Full path: wl_display.sync through the compositor, message loop, event stream and consumer. Reported
+	// under the same names as bench_event_native to compare with the X11 backend through Xwayland
+	struct wl_display* display = window_display(windows[0]);
+	bench_sync_t syncs[64];
+	const unsigned int burst = 64;
+	unsigned int bursts = (bench_iterations > 16) ? bench_iterations / 4 : 4;
+	size_t consumed = 0;
+
+	bench_drain();
+	tick_t start = time_current();
+	for (unsigned int iburst = 0; iburst < bursts; ++iburst) {
+		for (unsigned int isend = 0; isend < burst; ++isend) {
+			syncs[isend].window = windows[(iburst * burst + isend) % count];
+			syncs[isend].sent = time_current();
+			struct wl_callback* callback = wl_display_sync(display);
+			wl_callback_add_listener(callback, &bench_sync_listener, syncs + isend);
+		}
+		wl_display_flush(display);
+
+		unsigned int matched = 0;
+		tick_t wait_start = time_current();
+		while ((matched < burst) && (time_elapsed_ticks(wait_start) < time_ticks_per_second())) {
+			event_block_t* block = event_stream_process(window_event_stream());
+			event_t* event = 0;
+			tick_t now = time_current();
+			while ((event = event_next(block, event))) {
+				++consumed;
+				if (event->id != WINDOWEVENT_NATIVE)
+					continue;
+				tick_t sent;
+				memcpy(&sent, event->payload + sizeof(window_t*), sizeof(sent));
+				bench_samples_add(samples, now - sent);
+				++matched;
+			}
+			thread_yield();
+		}
+	}
+	bench_report_rate("event_native_throughput", count, consumed, time_elapsed_ticks(start));
+	bench_report("event_native_latency", count, samples);
+}
+
+#endif
+
+static void
+bench_allocate(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Storage only, no native window, to isolate allocator cost and the memory layout of many windows
+	int64_t allocations = bench_allocations();
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		tick_t start = time_current();
+		windows[iwin] = window_allocate();
+		bench_samples_add(samples, time_elapsed_ticks(start));
+	}
+	allocations = bench_allocations() - allocations;
+	bench_report("window_allocate", count, samples);
+
+	// Walk the hot fields the message loop touches per event, over all windows
+	int fd = bench_cache_misses_open();
+	unsigned int sink = 0;
+	bench_cache_misses_start(fd);
+	tick_t start = time_current();
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		for (unsigned int iwin = 0; iwin < count; ++iwin) {
+			window_t* window = windows[iwin];
+			sink += (unsigned int)window->handle + window->flags + (window->is_visible ? 1U : 0U);
+		}
+	}
+	tick_t elapsed = time_elapsed_ticks(start);
+	long long misses = bench_cache_misses_stop(fd);
+
+	// Access pattern of the message loop for input events, routed to windows in scattered order. Reads
+	// the routing and state fields, updates the live input state and reads the per event input fields
+	unsigned int stride = 7919;
+	while (count && ((count % stride) == 0))
+		stride += 2;
+	bench_cache_misses_start(fd);
+	tick_t loop_start = time_current();
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		for (unsigned int iwin = 0, index = 0; iwin < count; ++iwin, index = (index + stride) % count) {
+			window_t* window = windows[index];
+			sink += (unsigned int)window->handle + window->flags + window->input;
+			if (window->last_resize != window->last_paint)
+				++sink;
+#if FOUNDATION_PLATFORM_LINUX
+			sink += (window->mapped ? 1U : 0U) + (window->focus ? 2U : 0U) + (unsigned int)window->drawable;
+			window->input_live.x = (int32_t)iter;
+			window->input_live.y = (int32_t)iwin;
+			window->input_dirty = true;
+			sink += (window->xic ? 1U : 0U) + (window->pointer_history ? 2U : 0U) + (unsigned int)window->atom_delete +
+			        (window->cursor_grabbed ? 4U : 0U);
+#endif
+		}
+	}
+	tick_t loop_elapsed = time_elapsed_ticks(loop_start);
+	long long loop_misses = bench_cache_misses_stop(fd);
+	if (fd >= 0)
+		close(fd);
+
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		window_deallocate(windows[iwin]);
+		windows[iwin] = 0;
+	}
+
+	size_t walked = (size_t)bench_iterations * count;
+	fprintf(bench_output,
+	        "{\"benchmark\":\"window_pool\",\"windows\":%u,\"window_size\":%u,\"allocations_per_window\":%.3f,"
+	        "\"walk_ns_per_window\":%.3f,\"cache_misses_per_window\":%.3f,\"loop_walk_ns_per_window\":%.3f,"
+	        "\"loop_cache_misses_per_window\":%.3f}\n",
+	        count, (unsigned int)sizeof(window_t), (double)allocations / (double)count,
+	        bench_microseconds(elapsed) * 1000.0 / (double)walked,
+	        (misses >= 0) ? ((double)misses / (double)walked) : -1.0,
+	        bench_microseconds(loop_elapsed) * 1000.0 / (double)walked,
+	        (loop_misses >= 0) ? ((double)loop_misses / (double)walked) : -1.0);
+	fflush(bench_output);
+	FOUNDATION_UNUSED(sink);
+}
+
+static void
+bench_event_key(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Key events through the server and message loop. Consumers either read the typed key events
+	// decoded by the loop from the cached keymap, or decode native events themselves
+	Display* display = window_display(windows[0]);
+	KeyCode keycode = XKeysymToKeycode(display, XK_a);
+	const unsigned int burst = 32;
+	unsigned int bursts = (bench_iterations > 16) ? bench_iterations / 4 : 4;
+	bench_samples_t native_samples;
+	bench_samples_initialize(&native_samples, burst * bursts * 2);
+	size_t typed = 0;
+	uint32_t sink = 0;
+
+	bench_drain();
+	tick_t start = time_current();
+	for (unsigned int iburst = 0; iburst < bursts; ++iburst) {
+		XLockDisplay(display);
+		for (unsigned int isend = 0; isend < burst; ++isend) {
+			window_t* window = windows[(iburst * burst + isend) % count];
+			XEvent xevent;
+			memset(&xevent, 0, sizeof(xevent));
+			xevent.xkey.type = (isend & 1) ? KeyRelease : KeyPress;
+			xevent.xkey.display = display;
+			xevent.xkey.window = (Window)window_drawable(window);
+			xevent.xkey.root = DefaultRootWindow(display);
+			xevent.xkey.keycode = keycode;
+			xevent.xkey.same_screen = True;
+			XSendEvent(display, xevent.xkey.window, False, NoEventMask, &xevent);
+		}
+		XFlush(display);
+		XUnlockDisplay(display);
+
+		size_t expected = typed + burst;
+		tick_t wait_start = time_current();
+		while ((typed < expected) && (time_elapsed_ticks(wait_start) < time_ticks_per_second())) {
+			event_block_t* block = event_stream_process(window_event_stream());
+			event_t* event = 0;
+			while ((event = event_next(block, event))) {
+				if ((event->id == WINDOWEVENT_KEYDOWN) || (event->id == WINDOWEVENT_KEYUP)) {
+					tick_t decode_start = time_current();
+					sink += window_event_key(event)->symbol;
+					bench_samples_add(samples, time_elapsed_ticks(decode_start));
+					++typed;
+				} else if (event->id == WINDOWEVENT_NATIVE) {
+					XEvent* native = (XEvent*)(void*)(event->payload + sizeof(window_t*));
+					if ((native->type != KeyPress) && (native->type != KeyRelease))
+						continue;
+					char buffer[16];
+					KeySym symbol = 0;
+					tick_t decode_start = time_current();
+					XLookupString(&native->xkey, buffer, sizeof(buffer), &symbol, 0);
+					bench_samples_add(&native_samples, time_elapsed_ticks(decode_start));
+					sink += (uint32_t)symbol;
+				}
+			}
+			thread_yield();
+		}
+	}
+	bench_report_rate("event_key_throughput", count, typed, time_elapsed_ticks(start));
+	bench_report("event_key_decode_typed", count, samples);
+	bench_report("event_key_decode_native_lookup", count, &native_samples);
+	bench_samples_finalize(&native_samples);
+	FOUNDATION_UNUSED(sink);
+}
+
+static void
+bench_input_snapshot(window_t** windows, unsigned int count, bench_samples_t* samples) {
+	// Per tick input polling, the published snapshot against the round trips it replaces
+	Display* display = window_display(windows[0]);
+	window_input_state_t state;
+	uint32_t sink = 0;
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		tick_t start = time_current();
+		window_input_snapshot(windows[iter % count], &state);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+		sink += state.buttons + (uint32_t)state.x;
+	}
+	bench_report("input_snapshot", count, samples);
+
+	for (unsigned int iter = 0; iter < bench_iterations; ++iter) {
+		Window root, child;
+		int root_x, root_y, x, y;
+		unsigned int mask;
+		char keys[32];
+		tick_t start = time_current();
+		XLockDisplay(display);
+		XQueryPointer(display, (Window)window_drawable(windows[iter % count]), &root, &child, &root_x, &root_y, &x, &y,
+		              &mask);
+		XQueryKeymap(display, keys);
+		XUnlockDisplay(display);
+		bench_samples_add(samples, time_elapsed_ticks(start));
+		sink += mask + (uint32_t)x + (uint32_t)keys[0];
+	}
+	bench_report("input_query_roundtrip", count, samples);
+	FOUNDATION_UNUSED(sink);
+}
+
+static void
+bench_set_title(void) {
+	// Live status titles, 1000 updates per second spread over 50 windows. Updates are queued and
+	// coalesced by the message loop, the caller never takes the display lock
+	window_t* windows[50];
+	unsigned int count = sizeof(windows) / sizeof(windows[0]);
+	unsigned int updates = 1000;
+	bench_samples_t samples;
+	bench_samples_initialize(&samples, updates);
+	for (unsigned int iwin = 0; iwin < count; ++iwin) {
+		windows[iwin] = window_allocate();
+		window_create(windows[iwin], WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window benchmark"), 160, 120,
+		              WINDOW_FLAG_NOSHOW);
+	}
+	bench_drain();
+
+	char title[64];
+	tick_t ticks_per_update = time_ticks_per_second() / updates;
+	tick_t begin = time_current();
+	for (unsigned int iupdate = 0; iupdate < updates; ++iupdate) {
+		while (time_elapsed_ticks(begin) < (tick_t)iupdate * ticks_per_update)
+			thread_yield();
+		string_t str = string_format(title, sizeof(title), STRING_CONST("Window benchmark - %u fps - %u%%"),
+		                             60 + (iupdate % 7), (iupdate * 100) / updates);
+		tick_t start = time_current();
+		window_set_title(windows[iupdate % count], STRING_ARGS(str));
+		bench_samples_add(&samples, time_elapsed_ticks(start));
+	}
+	tick_t elapsed = time_elapsed_ticks(begin);
+	bench_report("set_title", count, &samples);
+	bench_report_rate("set_title_rate", count, updates, elapsed);
+
+	for (unsigned int iwin = 0; iwin < count; ++iwin)
+		window_deallocate(windows[iwin]);
+	bench_drain();
+	bench_samples_finalize(&samples);
+}
+
+static void
+bench_parse_command_line(void) {
+	const string_const_t* cmdline = environment_command_line();
+	for (size_t iarg = 0, asize = array_size(cmdline); iarg < asize; ++iarg) {
+		if (iarg + 1 >= asize)
+			break;
+		string_const_t value = cmdline[iarg + 1];
+		if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--output"))) {
+			char path[512];
+			string_t pathstr = string_copy(path, sizeof(path), STRING_ARGS(value));
+			FILE* file = fopen(pathstr.str, "w");
+			if (file)
+				bench_output = file;
+			else
+				log_warnf(HASH_WINDOW, WARNING_INVALID_VALUE, STRING_CONST("Unable to open output file: %.*s"),
+				          STRING_FORMAT(pathstr));
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--iterations"))) {
+			bench_iterations = string_to_uint(STRING_ARGS(value), false);
+			if (!bench_iterations)
+				bench_iterations = 1;
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--pool"))) {
+			// Window pool slab capacity, zero allocates windows individually
+			bench_pool_capacity = string_to_uint(STRING_ARGS(value), false);
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--windows"))) {
+			// Comma separated list of window counts, for example "1,10,100"
+			string_const_t list = value;
+			bench_window_count_size = 0;
+			size_t offset = 0;
+			while ((offset < list.length) && (bench_window_count_size < 8)) {
+				size_t next = string_find(list.str, list.length, ',', offset);
+				if (next == STRING_NPOS)
+					next = list.length;
+				unsigned int count = string_to_uint(list.str + offset, next - offset, false);
+				if (count)
+					bench_window_counts[bench_window_count_size++] = count;
+				offset = next + 1;
+			}
+		}
+	}
+}
+
+int
+main_initialize(void) {
+	foundation_config_t config;
+	application_t application;
+	window_config_t window_config;
+
+	memset(&config, 0, sizeof(config));
+	memset(&application, 0, sizeof(application));
+	application.name = string_const(STRING_CONST("Window library benchmark"));
+	application.short_name = string_const(STRING_CONST("bench_window"));
+	application.company = string_const(STRING_CONST(""));
+	application.version = window_module_version();
+	application.flags = APPLICATION_UTILITY;
+
+	log_set_suppress(0, ERRORLEVEL_INFO);
+
+	int ret = foundation_initialize(bench_memory_system(), application, config);
+	if (ret < 0)
+		return ret;
+
+	// Pool configuration is needed before the window module initializes
+	bench_output = stdout;
+	bench_parse_command_line();
+
+	memset(&window_config, 0, sizeof(window_config));
+	window_config.window_pool_capacity = bench_pool_capacity;
+	return window_module_initialize(window_config);
+}
+
+int
+main_run(void* main_arg) {
+	FOUNDATION_UNUSED(main_arg);
+
+	fprintf(bench_output, "{\"benchmark\":\"config\",\"window_pool_capacity\":%u}\n",
+	        (unsigned int)bench_pool_capacity);
+
+	// The anchor window keeps the display open and the message loop running between runs
+	window_t* anchor = window_allocate();
+	window_create(anchor, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window benchmark anchor"), 64, 64,
+	              WINDOW_FLAG_NOSHOW);
+	if (!window_is_open(anchor)) {
+		log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to create window, is a display available?"));
+		window_deallocate(anchor);
+		return -1;
+	}
+	bool x11 = !anchor->wayland;
+
+	fprintf(bench_output, "{\"benchmark\":\"info\",\"version\":\"%s\",\"iterations\":%u,\"backend\":\"%s\"}\n",
+	        string_from_version_static(window_module_version()).str, bench_iterations, x11 ? "x11" : "wayland");
+
+	thread_initialize(&bench_loop_thread, bench_loop, 0, STRING_CONST("bench_loop"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&bench_loop_thread);
+	while (!thread_is_running(&bench_loop_thread))
+		thread_yield();
+
+	unsigned int max_count = 0;
+	for (size_t icount = 0; icount < bench_window_count_size; ++icount)
+		max_count = (bench_window_counts[icount] > max_count) ? bench_window_counts[icount] : max_count;
+
+	window_t** windows = memory_allocate(HASH_WINDOW, sizeof(window_t*) * max_count, 0,
+	                                     MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	bench_samples_t samples;
+	bench_samples_initialize(&samples, (max_count > bench_iterations * 64) ? max_count : bench_iterations * 64);
+
+	bench_event_cross_thread(anchor, &samples, false);
+	bench_event_cross_thread(anchor, &samples, true);
+	bench_set_title();
+
+	for (size_t icount = 0; icount < bench_window_count_size; ++icount) {
+		unsigned int count = bench_window_counts[icount];
+		log_infof(HASH_WINDOW, STRING_CONST("Benchmarking with %u windows"), count);
+
+		bench_allocate(windows, count, &samples);
+		bench_create_async(windows, count, &samples);
+		bench_create_batch(windows, count);
+		if (x11)
+			bench_create_child(anchor, windows, count, &samples);
+		bench_create(windows, count, &samples);
+		// Let the initial map, expose and focus traffic settle before measuring
+		thread_sleep(100);
+		bench_drain();
+
+		bench_getters(windows, count, &samples);
+		bench_sizemove(windows, count, &samples, x11);
+		bench_event_post(windows, count);
+		bench_event_ring(windows, count);
+		if (x11) {
+			bench_event_native(windows, count, &samples);
+			bench_event_key(windows, count, &samples);
+			bench_input_snapshot(windows, count, &samples);
+		}
+#if WINDOW_ENABLE_WAYLAND
+		if (!x11)
+			bench_event_wayland(windows, count, &samples);
+#endif
+
+		bench_destroy(windows, count, &samples);
+	}
+
+	bench_report_stats();
+
+	window_message_quit();
+	thread_join(&bench_loop_thread);
+	thread_finalize(&bench_loop_thread);
+
+	window_deallocate(anchor);
+	bench_drain();
+
+	bench_samples_finalize(&samples);
+	memory_deallocate(windows);
+
+	if (bench_output != stdout)
+		fclose(bench_output);
+
+	return 0;
+}
+
+void
+main_finalize(void) {
+	window_module_finalize();
+	foundation_finalize();
+}
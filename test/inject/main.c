@@ -0,0 +1,432 @@
+/* main.c  -  Window input injection stress harness  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform window library in C11 providing basic support data types
+ * and functions to create and manage windows in a platform-independent fashion. The latest source
+ * code is always available at
+ *
+ * https://github.com/mjansson/window_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any
+ * restrictions.
+ *
+ */
+
+#include <foundation/foundation.h>
+#include <window/window.h>
+
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Injects input through XTest on a separate display connection, the way a real device would
+// arrive, and measures what reaches consumers of window_event_stream(). Results are written as
+// one JSON object per line like the benchmark suite.
+
+#define INJECT_MOTION 0
+#define INJECT_BUTTON 1
+#define INJECT_KEY 2
+#define INJECT_KIND_COUNT 3
+
+// Motion events encode their sequence number in the root position so latency can be matched exactly
+#define INJECT_MOTION_SPAN 512
+#define INJECT_MOTION_SLOTS (INJECT_MOTION_SPAN * INJECT_MOTION_SPAN)
+
+static const char* inject_kind_name[INJECT_KIND_COUNT] = {"motion", "button", "key"};
+
+static FILE* inject_output;
+static unsigned int inject_rate = 8000;
+static unsigned int inject_duration_ms = 2000;
+static unsigned int inject_window_count = 1;
+static unsigned int inject_consumer_sleep_ms;
+static bool inject_kind_enabled[INJECT_KIND_COUNT] = {true, false, false};
+// Consume typed pointer and key events instead of native events
+static bool inject_typed;
+// Enable XInput2 precise and raw input, implies typed events since precise motion has no native event
+static bool inject_precise;
+
+static thread_t inject_loop_thread;
+static thread_t inject_thread;
+static atomic32_t inject_done;
+
+static tick_t* inject_motion_time;
+static tick_t* inject_fifo_time[INJECT_KIND_COUNT];
+static size_t inject_fifo_capacity;
+static atomic32_t inject_count[INJECT_KIND_COUNT];
+
+static void*
+inject_loop(void* arg) {
+	FOUNDATION_UNUSED(arg);
+	window_message_loop();
+	return 0;
+}
+
+static void*
+inject_produce(void* arg) {
+	FOUNDATION_UNUSED(arg);
+
+	Display* display = XOpenDisplay(0);
+	if (!display) {
+		log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to open injection display"));
+		atomic_store32(&inject_done, 1, memory_order_release);
+		return 0;
+	}
+	int screen = DefaultScreen(display);
+	unsigned int keycode = XKeysymToKeycode(display, XK_a);
+
+	unsigned int kinds[INJECT_KIND_COUNT];
+	unsigned int kind_count = 0;
+	for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind) {
+		if (inject_kind_enabled[ikind])
+			kinds[kind_count++] = ikind;
+	}
+
+	size_t total = ((size_t)inject_rate * inject_duration_ms) / 1000;
+	tick_t interval = time_ticks_per_second() / (tick_t)(inject_rate ? inject_rate : 1);
+	tick_t start = time_current();
+	for (size_t iinject = 0; (iinject < total) && kind_count; ++iinject) {
+		tick_t due = start + interval * (tick_t)iinject;
+		while (time_current() < due)
+			thread_yield();
+
+		unsigned int kind = kinds[iinject % kind_count];
+		int32_t index = atomic_load32(&inject_count[kind], memory_order_relaxed);
+		if (kind == INJECT_MOTION) {
+			int32_t slot = index % INJECT_MOTION_SLOTS;
+			inject_motion_time[slot] = time_current();
+			XTestFakeMotionEvent(display, screen, 1 + (slot % INJECT_MOTION_SPAN), 1 + (slot / INJECT_MOTION_SPAN),
+			                     CurrentTime);
+		} else {
+			// Press and release count as one injected event each
+			if ((size_t)index + 2 > inject_fifo_capacity)
+				break;
+			inject_fifo_time[kind][index] = inject_fifo_time[kind][index + 1] = time_current();
+			if (kind == INJECT_BUTTON) {
+				XTestFakeButtonEvent(display, 1, True, CurrentTime);
+				XTestFakeButtonEvent(display, 1, False, CurrentTime);
+			} else {
+				XTestFakeKeyEvent(display, keycode, True, CurrentTime);
+				XTestFakeKeyEvent(display, keycode, False, CurrentTime);
+			}
+			++index;
+		}
+		XFlush(display);
+		atomic_store32(&inject_count[kind], index + 1, memory_order_release);
+	}
+
+	XSync(display, False);
+	XCloseDisplay(display);
+	atomic_store32(&inject_done, 1, memory_order_release);
+	return 0;
+}
+
+static int
+inject_tick_compare(const void* lhs, const void* rhs) {
+	tick_t a = *(const tick_t*)lhs;
+	tick_t b = *(const tick_t*)rhs;
+	return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+static double
+inject_microseconds(tick_t ticks) {
+	return ((double)ticks * 1000000.0) / (double)time_ticks_per_second();
+}
+
+static void
+inject_report_latency(const char* kind, tick_t* samples, size_t count) {
+	if (!count) {
+		fprintf(inject_output, "{\"benchmark\":\"inject_latency\",\"kind\":\"%s\",\"samples\":0}\n", kind);
+		return;
+	}
+	qsort(samples, count, sizeof(tick_t), inject_tick_compare);
+	size_t last = count - 1;
+	fprintf(inject_output,
+	        "{\"benchmark\":\"inject_latency\",\"kind\":\"%s\",\"samples\":%u,\"p50_us\":%.3f,\"p90_us\":%.3f,"
+	        "\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f}\n",
+	        kind, (unsigned int)count, inject_microseconds(samples[last / 2]),
+	        inject_microseconds(samples[(last * 90) / 100]), inject_microseconds(samples[(last * 99) / 100]),
+	        inject_microseconds(samples[(last * 999) / 1000]), inject_microseconds(samples[last]));
+}
+
+static void
+inject_parse_command_line(void) {
+	const string_const_t* cmdline = environment_command_line();
+	for (size_t iarg = 0, asize = array_size(cmdline); iarg < asize; ++iarg) {
+		if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--typed"))) {
+			inject_typed = true;
+			continue;
+		}
+		if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--precise"))) {
+			inject_typed = inject_precise = true;
+			continue;
+		}
+		if (iarg + 1 >= asize)
+			break;
+		string_const_t value = cmdline[iarg + 1];
+		if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--output"))) {
+			char path[512];
+			string_t pathstr = string_copy(path, sizeof(path), STRING_ARGS(value));
+			FILE* file = fopen(pathstr.str, "w");
+			if (file)
+				inject_output = file;
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--rate"))) {
+			inject_rate = string_to_uint(STRING_ARGS(value), false);
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--duration"))) {
+			inject_duration_ms = string_to_uint(STRING_ARGS(value), false);
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--windows"))) {
+			inject_window_count = string_to_uint(STRING_ARGS(value), false);
+			if (!inject_window_count)
+				inject_window_count = 1;
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--consumer-sleep"))) {
+			inject_consumer_sleep_ms = string_to_uint(STRING_ARGS(value), false);
+		} else if (string_equal(STRING_ARGS(cmdline[iarg]), STRING_CONST("--kind"))) {
+			// Comma separated list of motion, button and key
+			for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind) {
+				inject_kind_enabled[ikind] =
+				    (string_find_string(STRING_ARGS(value), inject_kind_name[ikind],
+				                        string_length(inject_kind_name[ikind]), 0) != STRING_NPOS);
+			}
+		}
+	}
+}
+
+int
+main_initialize(void) {
+	foundation_config_t config;
+	application_t application;
+	window_config_t window_config;
+
+	memset(&config, 0, sizeof(config));
+	memset(&application, 0, sizeof(application));
+	application.name = string_const(STRING_CONST("Window library input injection"));
+	application.short_name = string_const(STRING_CONST("inject_window"));
+	application.company = string_const(STRING_CONST(""));
+	application.version = window_module_version();
+	application.flags = APPLICATION_UTILITY;
+
+	log_set_suppress(0, ERRORLEVEL_INFO);
+
+	int ret = foundation_initialize(memory_system_malloc(), application, config);
+	if (ret < 0)
+		return ret;
+
+	memset(&window_config, 0, sizeof(window_config));
+	return window_module_initialize(window_config);
+}
+
+int
+main_run(void* main_arg) {
+	FOUNDATION_UNUSED(main_arg);
+
+	inject_output = stdout;
+	inject_parse_command_line();
+
+	int event_base, error_base, major, minor;
+	Display* probe = XOpenDisplay(0);
+	if (!probe || !XTestQueryExtension(probe, &event_base, &error_base, &major, &minor)) {
+		log_error(HASH_WINDOW, ERROR_UNSUPPORTED, STRING_CONST("XTest extension not available"));
+		if (probe)
+			XCloseDisplay(probe);
+		return -1;
+	}
+	XCloseDisplay(probe);
+
+	window_t** windows = memory_allocate(HASH_WINDOW, sizeof(window_t*) * inject_window_count, 0,
+	                                     MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	for (unsigned int iwin = 0; iwin < inject_window_count; ++iwin) {
+		windows[iwin] = window_allocate();
+		window_create(windows[iwin], WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window injection"),
+		              INJECT_MOTION_SPAN + 64, INJECT_MOTION_SPAN + 64, 0);
+		if (inject_precise)
+			window_input_enable(windows[iwin], WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+	}
+	if (!window_is_open(windows[0])) {
+		log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to create window"));
+		return -1;
+	}
+	// Typed pointer events are window relative, translate back to root to find the motion slot
+	int* origin = memory_allocate(HASH_WINDOW, sizeof(int) * 2 * inject_window_count, 0, MEMORY_PERSISTENT);
+	for (unsigned int iwin = 0; iwin < inject_window_count; ++iwin) {
+		origin[iwin * 2] = window_position_x(windows[iwin]);
+		origin[iwin * 2 + 1] = window_position_y(windows[iwin]);
+	}
+
+	thread_initialize(&inject_loop_thread, inject_loop, 0, STRING_CONST("inject_loop"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&inject_loop_thread);
+	thread_sleep(500);
+	event_stream_process(window_event_stream());
+
+	size_t total = ((size_t)inject_rate * inject_duration_ms) / 1000;
+	inject_fifo_capacity = total * 2 + 2;
+	inject_motion_time = memory_allocate(HASH_WINDOW, sizeof(tick_t) * INJECT_MOTION_SLOTS, 0, MEMORY_PERSISTENT);
+	for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind) {
+		inject_fifo_time[ikind] = memory_allocate(HASH_WINDOW, sizeof(tick_t) * inject_fifo_capacity, 0,
+		                                          MEMORY_PERSISTENT);
+		atomic_store32(&inject_count[ikind], 0, memory_order_relaxed);
+	}
+	tick_t* latency[INJECT_KIND_COUNT];
+	size_t latency_count[INJECT_KIND_COUNT] = {0, 0, 0};
+	size_t consumed[INJECT_KIND_COUNT] = {0, 0, 0};
+	for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind)
+		latency[ikind] = memory_allocate(HASH_WINDOW, sizeof(tick_t) * inject_fifo_capacity, 0, MEMORY_PERSISTENT);
+
+	size_t stream_events = 0;
+	size_t stream_bytes = 0;
+	size_t precise_events = 0;
+	size_t raw_events = 0;
+	size_t raw_samples = 0;
+	tick_t consumer_ticks = 0;
+	size_t max_block_events = 0;
+	size_t max_block_bytes = 0;
+	size_t blocks = 0;
+
+	atomic_store32(&inject_done, 0, memory_order_release);
+	thread_initialize(&inject_thread, inject_produce, 0, STRING_CONST("inject_produce"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&inject_thread);
+
+	tick_t start = time_current();
+	tick_t idle_since = 0;
+	tick_t idle_limit = time_ticks_per_second() / 2;
+	while (true) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		size_t block_events = 0;
+		size_t block_bytes = 0;
+		tick_t now = time_current();
+		while ((event = event_next(block, event))) {
+			++block_events;
+			block_bytes += event_payload_size(event);
+			if (inject_typed) {
+				if (event->id == WINDOWEVENT_POINTERMOVE) {
+					const window_pointer_event_t* pointer = window_event_pointer(event);
+					const window_t* window = window_event_window(event);
+					unsigned int iwin = 0;
+					while ((iwin < inject_window_count) && (windows[iwin] != window))
+						++iwin;
+					if (iwin == inject_window_count)
+						continue;
+					int slot = (origin[iwin * 2 + 1] + pointer->y - 1) * INJECT_MOTION_SPAN +
+					           (origin[iwin * 2] + pointer->x - 1);
+					// Only the latest of the compressed samples has a known arrival time
+					if ((slot >= 0) && (slot < INJECT_MOTION_SLOTS) && (consumed[INJECT_MOTION] < inject_fifo_capacity))
+						latency[INJECT_MOTION][latency_count[INJECT_MOTION]++] = now - inject_motion_time[slot];
+					consumed[INJECT_MOTION] += pointer->samples;
+				} else if (event->id == WINDOWEVENT_POINTERPRECISE) {
+					++precise_events;
+				} else if (event->id == WINDOWEVENT_POINTERRAW) {
+					++raw_events;
+					raw_samples += window_event_pointer_raw(event)->samples;
+				} else if (event->id == WINDOWEVENT_POINTERBUTTON) {
+					size_t index = consumed[INJECT_BUTTON]++;
+					if (index < inject_fifo_capacity)
+						latency[INJECT_BUTTON][latency_count[INJECT_BUTTON]++] =
+						    now - inject_fifo_time[INJECT_BUTTON][index];
+				} else if ((event->id == WINDOWEVENT_KEYDOWN) || (event->id == WINDOWEVENT_KEYUP)) {
+					size_t index = consumed[INJECT_KEY]++;
+					if (index < inject_fifo_capacity)
+						latency[INJECT_KEY][latency_count[INJECT_KEY]++] = now - inject_fifo_time[INJECT_KEY][index];
+				}
+				continue;
+			}
+			if (event->id != WINDOWEVENT_NATIVE)
+				continue;
+			const XEvent* native = (const XEvent*)(const void*)(event->payload + sizeof(window_t*));
+
+			if (native->type == MotionNotify) {
+				int slot = (native->xmotion.y_root - 1) * INJECT_MOTION_SPAN + (native->xmotion.x_root - 1);
+				if ((slot >= 0) && (slot < INJECT_MOTION_SLOTS) && (consumed[INJECT_MOTION] < inject_fifo_capacity))
+					latency[INJECT_MOTION][latency_count[INJECT_MOTION]++] = now - inject_motion_time[slot];
+				++consumed[INJECT_MOTION];
+			} else if ((native->type == ButtonPress) || (native->type == ButtonRelease)) {
+				size_t index = consumed[INJECT_BUTTON]++;
+				if (index < inject_fifo_capacity)
+					latency[INJECT_BUTTON][latency_count[INJECT_BUTTON]++] = now - inject_fifo_time[INJECT_BUTTON][index];
+			} else if ((native->type == KeyPress) || (native->type == KeyRelease)) {
+				size_t index = consumed[INJECT_KEY]++;
+				if (index < inject_fifo_capacity)
+					latency[INJECT_KEY][latency_count[INJECT_KEY]++] = now - inject_fifo_time[INJECT_KEY][index];
+			}
+		}
+		stream_events += block_events;
+		stream_bytes += block_bytes;
+		if (block_events) {
+			consumer_ticks += time_elapsed_ticks(now);
+			++blocks;
+			max_block_events = (block_events > max_block_events) ? block_events : max_block_events;
+			max_block_bytes = (block_bytes > max_block_bytes) ? block_bytes : max_block_bytes;
+			idle_since = 0;
+		} else if (atomic_load32(&inject_done, memory_order_acquire)) {
+			if (!idle_since)
+				idle_since = now;
+			else if (now - idle_since > idle_limit)
+				break;
+		}
+		if (inject_consumer_sleep_ms)
+			thread_sleep(inject_consumer_sleep_ms);
+		else
+			thread_yield();
+	}
+	tick_t elapsed = time_elapsed_ticks(start) - idle_limit;
+
+	thread_join(&inject_thread);
+	thread_finalize(&inject_thread);
+
+	fprintf(inject_output,
+	        "{\"benchmark\":\"inject_info\",\"rate\":%u,\"duration_ms\":%u,\"windows\":%u,\"consumer_sleep_ms\":%u,"
+	        "\"typed\":%s}\n",
+	        inject_rate, inject_duration_ms, inject_window_count, inject_consumer_sleep_ms,
+	        inject_typed ? "true" : "false");
+	for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind) {
+		if (!inject_kind_enabled[ikind])
+			continue;
+		size_t injected = (size_t)atomic_load32(&inject_count[ikind], memory_order_acquire);
+		fprintf(inject_output,
+		        "{\"benchmark\":\"inject_delivery\",\"kind\":\"%s\",\"injected\":%u,\"consumed\":%u,\"dropped\":%d}\n",
+		        inject_kind_name[ikind], (unsigned int)injected, (unsigned int)consumed[ikind],
+		        (int)injected - (int)consumed[ikind]);
+		inject_report_latency(inject_kind_name[ikind], latency[ikind], latency_count[ikind]);
+	}
+	if (inject_precise) {
+		fprintf(inject_output,
+		        "{\"benchmark\":\"inject_precise\",\"precise_events\":%u,\"raw_events\":%u,\"raw_samples\":%u}\n",
+		        (unsigned int)precise_events, (unsigned int)raw_events, (unsigned int)raw_samples);
+	}
+	double seconds = (double)elapsed / (double)time_ticks_per_second();
+	fprintf(inject_output,
+	        "{\"benchmark\":\"inject_dispatch\",\"stream_events\":%u,\"blocks\":%u,\"events_per_second\":%.1f,"
+	        "\"max_block_events\":%u,\"max_block_payload_bytes\":%u,\"stream_payload_bytes\":%u,"
+	        "\"consumer_us\":%.1f}\n",
+	        (unsigned int)stream_events, (unsigned int)blocks, (seconds > 0) ? ((double)stream_events / seconds) : 0.0,
+	        (unsigned int)max_block_events, (unsigned int)max_block_bytes, (unsigned int)stream_bytes,
+	        inject_microseconds(consumer_ticks));
+	fflush(inject_output);
+
+	window_message_quit();
+	thread_join(&inject_loop_thread);
+	thread_finalize(&inject_loop_thread);
+
+	for (unsigned int iwin = 0; iwin < inject_window_count; ++iwin)
+		window_deallocate(windows[iwin]);
+	event_stream_process(window_event_stream());
+
+	for (unsigned int ikind = 0; ikind < INJECT_KIND_COUNT; ++ikind) {
+		memory_deallocate(inject_fifo_time[ikind]);
+		memory_deallocate(latency[ikind]);
+	}
+	memory_deallocate(inject_motion_time);
+	memory_deallocate(origin);
+	memory_deallocate(windows);
+
+	if (inject_output != stdout)
+		fclose(inject_output);
+
+	return 0;
+}
+
+void
+main_finalize(void) {
+	window_module_finalize();
+	foundation_finalize();
+}
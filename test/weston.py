@@ -0,0 +1,72 @@
+#!/usr/bin/env python
+
+"""Run a test or benchmark binary under a headless Weston compositor"""
+
+import sys
+import os
+import re
+import subprocess
+import tempfile
+import time
+
+def wait_for(condition, timeout):
+  deadline = time.time() + timeout
+  while time.time() < deadline:
+    result = condition()
+    if result:
+      return result
+    time.sleep(0.05)
+  return None
+
+def main(argv):
+  if len(argv) < 3 or argv[1] not in ['wayland', 'x11']:
+    print('Usage: weston.py <wayland|x11> <binary> [arguments]')
+    return 1
+  backend = argv[1]
+
+  #Weston refuses to start without a private runtime directory
+  runtimedir = os.environ.get('XDG_RUNTIME_DIR')
+  if not runtimedir or not os.path.isdir(runtimedir):
+    runtimedir = tempfile.mkdtemp(prefix = 'weston-')
+  os.chmod(runtimedir, 0o700)
+
+  socket = 'window-test-' + str(os.getpid())
+  logfile = os.path.join(runtimedir, socket + '.log')
+  env = os.environ.copy()
+  env['XDG_RUNTIME_DIR'] = runtimedir
+  env.pop('DISPLAY', None)
+  env.pop('WAYLAND_DISPLAY', None)
+
+  command = ['weston', '--backend=headless-backend.so', '--socket=' + socket, '--idle-time=0', '--log=' + logfile]
+  #Xwayland is started by Weston, the X11 backend is measured through it
+  if backend == 'x11':
+    command += ['--xwayland']
+  try:
+    weston = subprocess.Popen(command, env = env)
+  except OSError:
+    print('Unable to start weston, is it installed?')
+    return 1
+
+  try:
+    if not wait_for(lambda: os.path.exists(os.path.join(runtimedir, socket)), 10):
+      print('Weston did not create socket ' + socket + ', see ' + logfile)
+      return 1
+    env['WAYLAND_DISPLAY'] = socket
+    env['WINDOW_BACKEND'] = backend
+    if backend == 'x11':
+      def xwayland_display():
+        with open(logfile) as log:
+          match = re.search(r'listening on display (:\d+)', log.read())
+        return match.group(1) if match else None
+      display = wait_for(xwayland_display, 10)
+      if not display:
+        print('Weston did not start Xwayland, see ' + logfile)
+        return 1
+      env['DISPLAY'] = display
+    return subprocess.call(argv[2:], env = env)
+  finally:
+    weston.terminate()
+    weston.wait()
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -16,6 +16,13 @@
 #include <window/window.h>
 #include <test/test.h>
 
+#if FOUNDATION_PLATFORM_LINUX
+#include <X11/Xatom.h>
+#include <X11/Xproto.h>
+#include <X11/keysym.h>
+#include <X11/extensions/sync.h>
+#endif
+
 static application_t
 test_window_application(void) {
 	application_t app;
@@ -28,9 +35,28 @@ test_window_application(void) {
 	return app;
 }
 
+// Counts allocations to verify the steady state event path does not allocate, see test zeroalloc
+static memory_system_t test_memory_base;
+static atomic64_t test_memory_allocations;
+
+static void*
+test_window_memory_allocate(hash_t context, size_t size, unsigned int align, unsigned int hint) {
+	atomic_add64(&test_memory_allocations, 1, memory_order_relaxed);
+	return test_memory_base.allocate(context, size, align, hint);
+}
+
+static void*
+test_window_memory_reallocate(void* p, size_t size, unsigned int align, size_t oldsize, unsigned int hint) {
+	atomic_add64(&test_memory_allocations, 1, memory_order_relaxed);
+	return test_memory_base.reallocate(p, size, align, oldsize, hint);
+}
+
 static memory_system_t
 test_window_memory_system(void) {
-	return memory_system_malloc();
+	memory_system_t system = test_memory_base = memory_system_malloc();
+	system.allocate = test_window_memory_allocate;
+	system.reallocate = test_window_memory_reallocate;
+	return system;
 }
 
 static foundation_config_t
@@ -125,6 +151,10 @@ DECLARE_TEST(window, createdestroy) {
 
 	EXPECT_TRUE(window_is_open(&window));
 
+	window_handle_t handle = window_handle(&window);
+	EXPECT_NE(handle, WINDOW_HANDLE_INVALID);
+	EXPECT_EQ(window_handle_resolve(handle), &window);
+
 	got_create = got_destroy = got_show = got_hide = got_focus = got_unfocus = got_redraw = got_resize = got_other = 0;
 
 	thread_initialize(&thread, createdestroy_thread, &window, STRING_CONST("createdestroy_thread"),
@@ -138,6 +168,9 @@ DECLARE_TEST(window, createdestroy) {
 	window_finalize(&window);
 	thread_finalize(&thread);
 
+	// Stale handles from events posted before finalize no longer resolve
+	EXPECT_EQ(window_handle_resolve(handle), nullptr);
+
 	if (ret)
 		return ret;
 
@@ -434,10 +467,1117 @@ DECLARE_TEST(window, sizemove) {
 	return ret;
 }
 
+DECLARE_TEST(window, eventstats) {
+	window_t window;
+	window_event_stats_t stats;
+	event_t* event = 0;
+
+	memset(&window, 0, sizeof(window));
+
+	event_stream_process(window_event_stream());
+	window_event_stats_reset();
+
+	for (int ievent = 0; ievent < 100; ++ievent)
+		window_event_post(WINDOWEVENT_REDRAW, &window);
+
+	window_event_stats(&stats);
+	EXPECT_UINTEQ((unsigned int)stats.posted[WINDOWEVENT_REDRAW], 100);
+	EXPECT_UINTEQ((unsigned int)stats.dropped[WINDOWEVENT_REDRAW], 0);
+	EXPECT_UINTEQ((unsigned int)stats.posted[WINDOWEVENT_CLOSE], 0);
+	EXPECT_SIZEGT(stats.depth, 0);
+	EXPECT_SIZEGE(stats.high_water, stats.depth);
+	EXPECT_SIZEGE((size_t)stats.bytes, stats.depth);
+
+	int got_events = 0;
+	event_block_t* block = event_stream_process(window_event_stream());
+	while ((event = event_next(block, event))) {
+		if ((event->id == WINDOWEVENT_REDRAW) && (window_event_window(event) == &window))
+			++got_events;
+	}
+	EXPECT_INTEQ(got_events, 100);
+
+	window_event_stats(&stats);
+	EXPECT_SIZEEQ(stats.depth, 0);
+	EXPECT_SIZEGT(stats.high_water, 0);
+
+	return 0;
+}
+
+DECLARE_TEST(window, eventring) {
+	window_t window;
+	window_event_record_t* records;
+	window_event_record_t record;
+
+	memset(&window, 0, sizeof(window));
+	window_event_ring_t* ring = window_event_ring_allocate(3);
+	EXPECT_NE(ring, nullptr);
+
+	for (uint32_t ievent = 0; ievent < 4; ++ievent)
+		EXPECT_TRUE(window_event_ring_write(ring, WINDOWEVENT_RESIZE, &window, &ievent, sizeof(ievent)));
+	EXPECT_FALSE(window_event_ring_write(ring, WINDOWEVENT_RESIZE, &window, 0, 0));
+	EXPECT_SIZEEQ(window_event_ring_size(ring), 4);
+
+	EXPECT_SIZEEQ(window_event_ring_acquire(ring, &records, 3), 3);
+	for (uint32_t ievent = 0; ievent < 3; ++ievent) {
+		uint32_t value;
+		memcpy(&value, records[ievent].payload, sizeof(value));
+		EXPECT_INTEQ(records[ievent].id, WINDOWEVENT_RESIZE);
+		EXPECT_EQ(records[ievent].window, &window);
+		EXPECT_UINTEQ(records[ievent].size, sizeof(value));
+		EXPECT_UINTEQ(value, ievent);
+	}
+	window_event_ring_release(ring, 3);
+
+	// Wraps around, acquire only returns the contiguous run up to the end of the ring
+	EXPECT_TRUE(window_event_ring_write(ring, WINDOWEVENT_CLOSE, &window, 0, 0));
+	EXPECT_SIZEEQ(window_event_ring_acquire(ring, &records, 16), 1);
+	window_event_ring_release(ring, 1);
+
+	EXPECT_TRUE(window_event_ring_read(ring, &record));
+	EXPECT_INTEQ(record.id, WINDOWEVENT_CLOSE);
+	EXPECT_FALSE(window_event_ring_read(ring, &record));
+	EXPECT_SIZEEQ(window_event_ring_size(ring), 0);
+
+	window_event_ring_deallocate(ring);
+
+	return 0;
+}
+
+DECLARE_TEST(window, subscribe) {
+	window_t window;
+	window_t other;
+	window_event_record_t* records;
+
+	memset(&window, 0, sizeof(window));
+	memset(&other, 0, sizeof(other));
+	event_stream_process(window_event_stream());
+
+	window_event_ring_t* ring =
+	    window_event_subscribe(&window, WINDOW_EVENT_MASK(WINDOWEVENT_RESIZE) | WINDOW_EVENT_MASK(WINDOWEVENT_CLOSE), 0);
+	EXPECT_NE(ring, nullptr);
+
+	window_event_post(WINDOWEVENT_RESIZE, &window);
+	window_event_post(WINDOWEVENT_REDRAW, &window);
+	window_event_post(WINDOWEVENT_RESIZE, &other);
+	window_event_post(WINDOWEVENT_CLOSE, &window);
+
+	EXPECT_SIZEEQ(window_event_ring_acquire(ring, &records, 16), 2);
+	EXPECT_INTEQ(records[0].id, WINDOWEVENT_RESIZE);
+	EXPECT_EQ(records[0].window, &window);
+	EXPECT_INTEQ(records[1].id, WINDOWEVENT_CLOSE);
+	window_event_ring_release(ring, 2);
+
+	// The shared stream still receives all events
+	int got_events = 0;
+	event_t* event = 0;
+	event_block_t* block = event_stream_process(window_event_stream());
+	while ((event = event_next(block, event)))
+		++got_events;
+	EXPECT_INTEQ(got_events, 4);
+
+	window_event_unsubscribe(ring);
+	window_event_post(WINDOWEVENT_RESIZE, &window);
+	event_stream_process(window_event_stream());
+
+	return 0;
+}
+
+static int got_callback;
+
+static void
+callback_resize(window_t* window, window_event_id id, const void* native, void* userdata) {
+	FOUNDATION_UNUSED(native);
+	if ((id == WINDOWEVENT_RESIZE) && (window == userdata))
+		++got_callback;
+}
+
+DECLARE_TEST(window, callback) {
+	window_t window;
+	window_t other;
+
+	memset(&window, 0, sizeof(window));
+	memset(&other, 0, sizeof(other));
+	got_callback = 0;
+	window_event_set_callback(&window, WINDOWEVENT_RESIZE, callback_resize, &window);
+
+	window_event_post(WINDOWEVENT_RESIZE, &window);
+	EXPECT_INTEQ(got_callback, 1);
+	window_event_post(WINDOWEVENT_REDRAW, &window);
+	window_event_post(WINDOWEVENT_RESIZE, &other);
+	EXPECT_INTEQ(got_callback, 1);
+
+	window_event_set_callback(&window, WINDOWEVENT_RESIZE, nullptr, nullptr);
+	window_event_post(WINDOWEVENT_RESIZE, &window);
+	EXPECT_INTEQ(got_callback, 1);
+
+	event_stream_process(window_event_stream());
+
+	return 0;
+}
+
+static int64_t zeroalloc_allocations;
+
+static unsigned int
+zeroalloc_round(window_t* window, unsigned int round) {
+	unsigned int got_native = 0;
+	window_event_post(WINDOWEVENT_REDRAW, window);
+	window_event_post(WINDOWEVENT_RESIZE, window);
+#if FOUNDATION_PLATFORM_LINUX
+	// Round trip a client message through the server and the message loop
+	Display* display = window_display(window);
+	if (display && !window->wayland) {
+		XEvent xevent;
+		memset(&xevent, 0, sizeof(xevent));
+		xevent.xclient.type = ClientMessage;
+		xevent.xclient.window = (Window)window_drawable(window);
+		xevent.xclient.message_type = XA_STRING;
+		xevent.xclient.format = 32;
+		xevent.xclient.data.l[0] = (long)round;
+		XLockDisplay(display);
+		XSendEvent(display, xevent.xclient.window, False, NoEventMask, &xevent);
+		XFlush(display);
+		XUnlockDisplay(display);
+	} else {
+		got_native = 1;
+	}
+#else
+	got_native = 1;
+#endif
+	tick_t start = time_current();
+	unsigned int got_events = 0;
+	while (((got_events < 2) || !got_native) && (time_elapsed_ticks(start) < time_ticks_per_second())) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (((event->id == WINDOWEVENT_REDRAW) || (event->id == WINDOWEVENT_RESIZE)) &&
+			    (window_event_window(event) == window))
+				++got_events;
+			else if (event->id == WINDOWEVENT_NATIVE)
+				got_native = 1;
+		}
+		thread_yield();
+	}
+	return got_native ? got_events : 0;
+}
+
+static void*
+zeroalloc_thread(void* arg) {
+	window_t* window = arg;
+
+	// Let the initial map and focus traffic settle, and warm up both stream blocks
+	thread_sleep(500);
+	event_stream_process(window_event_stream());
+	event_stream_process(window_event_stream());
+	for (unsigned int round = 0; round < 4; ++round)
+		zeroalloc_round(window, round);
+
+	int64_t before = atomic_load64(&test_memory_allocations, memory_order_relaxed);
+	unsigned int got_events = 0;
+	for (unsigned int round = 0; round < 100; ++round)
+		got_events += zeroalloc_round(window, round);
+	zeroalloc_allocations = atomic_load64(&test_memory_allocations, memory_order_relaxed) - before;
+
+	window_message_quit();
+
+	EXPECT_INTGE((int)got_events, 200);
+
+	return 0;
+}
+
+DECLARE_TEST(window, zeroalloc) {
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+
+#if FOUNDATION_PLATFORM_WINDOWS || FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_BSD
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, 0);
+#elif FOUNDATION_PLATFORM_MACOS || FOUNDATION_PLATFORM_IOS
+	window_initialize(&window, delegate_window());
+#endif
+
+	EXPECT_TRUE(window_is_open(&window));
+
+	zeroalloc_allocations = -1;
+	thread_initialize(&thread, zeroalloc_thread, &window, STRING_CONST("zeroalloc_thread"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+
+	// Message loop and event posting must not allocate once windows exist
+	EXPECT_INTEQ((int)zeroalloc_allocations, 0);
+
+	return 0;
+}
+
+DECLARE_TEST(window, errorstats) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	window_error_stats_t stats;
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+
+	Display* display = window_display(&window);
+	if (display && !window.wayland) {
+		window_error_stats_reset();
+
+		// Mapping a nonexistent window generates a BadWindow error
+		XLockDisplay(display);
+		XMapWindow(display, (Window)1);
+		XSync(display, False);
+		XUnlockDisplay(display);
+
+		window_error_stats(&stats);
+		EXPECT_UINTEQ((unsigned int)stats.total, 1);
+		EXPECT_UINTEQ((unsigned int)stats.code[BadWindow], 1);
+		EXPECT_UINTEQ((unsigned int)stats.request[X_MapWindow], 1);
+		EXPECT_UINTEQ(stats.last_code, BadWindow);
+		EXPECT_UINTEQ(stats.last_request, X_MapWindow);
+		EXPECT_UINTEQ((unsigned int)stats.suppressed, 0);
+
+		// A second error within the trace interval is only counted
+		XLockDisplay(display);
+		XMapWindow(display, (Window)1);
+		XSync(display, False);
+		XUnlockDisplay(display);
+
+		window_error_stats(&stats);
+		EXPECT_UINTEQ((unsigned int)stats.total, 2);
+		EXPECT_UINTEQ((unsigned int)stats.suppressed, 1);
+	}
+
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static void*
+createasync_thread(void* arg) {
+	window_t* window = arg;
+	int got_create_first = 0;
+
+	got_create = got_show = 0;
+	tick_t start = time_current();
+	while ((!got_create || !got_show) && (time_elapsed_ticks(start) < time_ticks_per_second() * 2)) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (window_event_window(event) != window)
+				continue;
+			if (event->id == WINDOWEVENT_CREATE) {
+				got_create_first = !got_show;
+				++got_create;
+			} else if (event->id == WINDOWEVENT_SHOW) {
+				++got_show;
+			}
+		}
+		thread_yield();
+	}
+
+	window_message_quit();
+
+	EXPECT_INTEQ(got_create, 1);
+	EXPECT_INTEQ(got_show, 1);
+	EXPECT_TRUE(got_create_first);
+
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, createasync) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+	event_stream_process(window_event_stream());
+
+	window_create_async(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, 0);
+	// Native handles are valid immediately, the window is not necessarily mapped yet
+	EXPECT_TRUE(window_is_open(&window));
+
+	thread_initialize(&thread, createasync_thread, &window, STRING_CONST("createasync_thread"),
+	                  THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+#endif
+	return 0;
+}
+
+DECLARE_TEST(window, createchild) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t parent;
+
+	window_create(&parent, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&parent));
+
+	if (!parent.wayland) {
+		window_t* child = window_create_child(&parent, 10, 10, 64, 64, 0);
+		EXPECT_NE(child, nullptr);
+		EXPECT_TRUE(window_is_open(child));
+		EXPECT_NE(window_drawable(child), window_drawable(&parent));
+		EXPECT_EQ(window_handle_resolve(window_handle(child)), child);
+		window_deallocate(child);
+
+		// Children still open are finalized with the parent
+		child = window_create_child(&parent, 10, 10, 64, 64, 0);
+		EXPECT_TRUE(window_is_open(child));
+		window_handle_t handle = window_handle(child);
+		window_finalize(&parent);
+		EXPECT_FALSE(window_is_open(child));
+		EXPECT_EQ(window_handle_resolve(handle), nullptr);
+		window_deallocate(child);
+
+		// Top level windows without a title still get the window manager protocols
+		window_create(&parent, WINDOW_ADAPTER_DEFAULT, nullptr, 0, 320, 240, WINDOW_FLAG_NOSHOW);
+		EXPECT_TRUE(window_is_open(&parent));
+		EXPECT_NE(parent.atom_delete, 0);
+		EXPECT_EQ(parent.parent, nullptr);
+	}
+
+	window_finalize(&parent);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static void
+inputmask_native(window_t* window, window_event_id id, const void* native, void* userdata) {
+	FOUNDATION_UNUSED(window);
+	FOUNDATION_UNUSED(id);
+	FOUNDATION_UNUSED(native);
+	FOUNDATION_UNUSED(userdata);
+}
+
+#endif
+
+DECLARE_TEST(window, inputmask) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+
+	if (!window.wayland) {
+		// Core input is selected by default
+		EXPECT_NE(window.event_mask & PointerMotionMask, 0);
+		EXPECT_NE(window.event_mask & KeyPressMask, 0);
+		EXPECT_NE(window.event_mask & ButtonPressMask, 0);
+
+		// Nothing consumes input, only structure events are selected
+		window_input_disable(&window, WINDOW_INPUT_ALL);
+		EXPECT_EQ(window.event_mask & (PointerMotionMask | KeyPressMask | ButtonPressMask), 0);
+		EXPECT_NE(window.event_mask & StructureNotifyMask, 0);
+
+		window_input_enable(&window, WINDOW_INPUT_KEYBOARD);
+		EXPECT_NE(window.event_mask & KeyPressMask, 0);
+		EXPECT_EQ(window.event_mask & PointerMotionMask, 0);
+
+		window_event_set_callback(&window, WINDOWEVENT_NATIVE, inputmask_native, nullptr);
+		EXPECT_NE(window.event_mask & PointerMotionMask, 0);
+		window_event_set_callback(&window, WINDOWEVENT_NATIVE, nullptr, nullptr);
+		EXPECT_EQ(window.event_mask & PointerMotionMask, 0);
+
+		window_input_disable(&window, WINDOW_INPUT_KEYBOARD);
+		EXPECT_EQ(window.event_mask & KeyPressMask, 0);
+
+		// Precise and raw input are opt in, not part of the core categories
+		window_input_enable(&window, WINDOW_INPUT_ALL);
+		EXPECT_EQ(window.input & (WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW), 0);
+		window_input_enable(&window, WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+		EXPECT_EQ(window.input & (WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW), WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+		window_input_disable(&window, WINDOW_INPUT_ALL | WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+		EXPECT_EQ(window.xi_input, 0);
+		EXPECT_EQ(window.event_mask & PointerMotionMask, 0);
+	}
+
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static void
+keyevent_send(window_t* window, int type) {
+	Display* display = window_display(window);
+	XEvent xevent;
+	memset(&xevent, 0, sizeof(xevent));
+	xevent.xkey.type = type;
+	xevent.xkey.display = display;
+	xevent.xkey.window = (Window)window_drawable(window);
+	xevent.xkey.root = DefaultRootWindow(display);
+	xevent.xkey.keycode = XKeysymToKeycode(display, XK_a);
+	xevent.xkey.same_screen = True;
+	XLockDisplay(display);
+	XSendEvent(display, xevent.xkey.window, False, NoEventMask, &xevent);
+	XFlush(display);
+	XUnlockDisplay(display);
+}
+
+static void*
+keyevent_thread(void* arg) {
+	window_t* window = arg;
+	window_key_event_t down[2];
+	int got_down = 0, got_up = 0, got_text = 0;
+
+	thread_sleep(100);
+	event_stream_process(window_event_stream());
+
+	keyevent_send(window, KeyPress);
+	keyevent_send(window, KeyPress);
+	keyevent_send(window, KeyRelease);
+
+	tick_t start = time_current();
+	while (!got_up && (time_elapsed_ticks(start) < time_ticks_per_second())) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if ((event->id == WINDOWEVENT_KEYDOWN) && (got_down < 2))
+				down[got_down++] = *window_event_key(event);
+			else if (event->id == WINDOWEVENT_KEYUP)
+				++got_up;
+			else if ((event->id == WINDOWEVENT_TEXT) && (window_event_text(event)->length == 1) &&
+			         (window_event_text(event)->text[0] == 'a'))
+				++got_text;
+		}
+		thread_yield();
+	}
+
+	window_message_quit();
+
+	EXPECT_INTEQ(got_down, 2);
+	EXPECT_INTEQ(got_up, 1);
+	EXPECT_UINTEQ(down[0].symbol, XK_a);
+	EXPECT_UINTEQ(down[0].repeat, 0);
+	EXPECT_UINTEQ(down[1].repeat, 1);
+	// Text requires an input context
+	if (window->xic) {
+		EXPECT_INTEQ(got_text, 2);
+	} else {
+		log_info(HASH_TEST, STRING_CONST("No input context, skipped text event check"));
+	}
+
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, keyevent) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, 0);
+	EXPECT_TRUE(window_is_open(&window));
+	if (window.wayland) {
+		window_finalize(&window);
+		return 0;
+	}
+
+	thread_initialize(&thread, keyevent_thread, &window, STRING_CONST("keyevent_thread"), THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static void
+pointerevent_send(Display* display, window_t* window, int type, int x, unsigned int button) {
+	XEvent xevent;
+	memset(&xevent, 0, sizeof(xevent));
+	xevent.type = type;
+	xevent.xany.display = display;
+	xevent.xany.window = (Window)window_drawable(window);
+	if (type == MotionNotify) {
+		xevent.xmotion.root = DefaultRootWindow(display);
+		xevent.xmotion.x = x;
+		xevent.xmotion.y = 10;
+		xevent.xmotion.time = (Time)x;
+		xevent.xmotion.same_screen = True;
+	} else {
+		xevent.xbutton.root = DefaultRootWindow(display);
+		xevent.xbutton.x = x;
+		xevent.xbutton.y = 10;
+		xevent.xbutton.button = button;
+		xevent.xbutton.same_screen = True;
+	}
+	XSendEvent(display, xevent.xany.window, False, NoEventMask, &xevent);
+}
+
+static void*
+pointerevent_thread(void* arg) {
+	window_t* window = arg;
+	Display* display = window_display(window);
+	unsigned int samples = 0, moves = 0, buttons = 0, wheels = 0;
+	window_pointer_event_t last_move, wheel;
+	memset(&last_move, 0, sizeof(last_move));
+	memset(&wheel, 0, sizeof(wheel));
+
+	thread_sleep(100);
+	event_stream_process(window_event_stream());
+
+	XLockDisplay(display);
+	pointerevent_send(display, window, MotionNotify, 10, 0);
+	pointerevent_send(display, window, MotionNotify, 20, 0);
+	pointerevent_send(display, window, MotionNotify, 30, 0);
+	pointerevent_send(display, window, ButtonPress, 30, Button4);
+	pointerevent_send(display, window, ButtonRelease, 30, Button4);
+	pointerevent_send(display, window, ButtonPress, 30, Button1);
+	pointerevent_send(display, window, ButtonRelease, 30, Button1);
+	XFlush(display);
+	XUnlockDisplay(display);
+
+	tick_t start = time_current();
+	while ((buttons < 2) && (time_elapsed_ticks(start) < time_ticks_per_second())) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (event->id == WINDOWEVENT_POINTERMOVE) {
+				last_move = *window_event_pointer(event);
+				samples += last_move.samples;
+				++moves;
+			} else if (event->id == WINDOWEVENT_POINTERWHEEL) {
+				wheel = *window_event_pointer(event);
+				++wheels;
+			} else if (event->id == WINDOWEVENT_POINTERBUTTON) {
+				++buttons;
+			}
+		}
+		thread_yield();
+	}
+
+	window_pointer_sample_t history[8];
+	size_t history_count = window_pointer_history(window, history, 8);
+
+	// State is published at the end of the loop wake-up, after the events are posted
+	window_input_state_t state;
+	start = time_current();
+	do {
+		window_input_snapshot(window, &state);
+	} while (((state.x != 30) || state.buttons || (state.wheel_y < 1.0)) &&
+	         (time_elapsed_ticks(start) < time_ticks_per_second()));
+
+	window_message_quit();
+
+	// Motion is compressed, every sample is accounted for and the latest position is reported
+	EXPECT_UINTEQ(samples, 3);
+	EXPECT_INTLE((int)moves, 3);
+	EXPECT_INTEQ(last_move.x, 30);
+	EXPECT_UINTEQ(wheels, 1);
+	EXPECT_INTEQ(wheel.wheel_y, 1);
+	EXPECT_UINTEQ(buttons, 2);
+	EXPECT_SIZEEQ(history_count, 3);
+	EXPECT_INTEQ(history[0].x, 10);
+	EXPECT_INTEQ(history[2].x, 30);
+	EXPECT_UINTEQ(history[2].time, 30);
+	EXPECT_NE(state.sequence, 0);
+	EXPECT_INTEQ(state.x, 30);
+	EXPECT_UINTEQ(state.buttons, 0);
+	EXPECT_REALEQ((real)state.wheel_y, REAL_C(1.0));
+
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, pointerevent) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, 0);
+	EXPECT_TRUE(window_is_open(&window));
+	if (window.wayland) {
+		window_finalize(&window);
+		return 0;
+	}
+	window_input_enable(&window, WINDOW_INPUT_BUTTON | WINDOW_INPUT_MOTION);
+	window_pointer_history_enable(&window, 8);
+
+	thread_initialize(&thread, pointerevent_thread, &window, STRING_CONST("pointerevent_thread"),
+	                  THREAD_PRIORITY_NORMAL, 0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+#endif
+	return 0;
+}
+
+DECLARE_TEST(window, cursorlock) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+
+	if (!window.wayland) {
+		EXPECT_FALSE(window_is_cursor_locked(&window));
+
+		// Grab is deferred until the window has focus
+		window_show_cursor(&window, false, true);
+		EXPECT_TRUE(window_is_cursor_locked(&window));
+		EXPECT_TRUE(window.cursor_hidden);
+		EXPECT_FALSE(window.cursor_grabbed);
+
+		window_show_cursor(&window, true, false);
+		EXPECT_FALSE(window_is_cursor_locked(&window));
+		EXPECT_FALSE(window.cursor_hidden);
+	}
+
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+DECLARE_TEST(window, fullscreen) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240,
+	              WINDOW_FLAG_NOSHOW | WINDOW_FLAG_FULLSCREEN);
+	EXPECT_TRUE(window_is_open(&window));
+
+	if (!window.wayland) {
+		EXPECT_TRUE(window_is_fullscreen(&window));
+
+		// Toggle without recreating, native window is kept
+		unsigned long drawable = window_drawable(&window);
+		window_set_fullscreen(&window, false, WINDOW_MONITOR_CURRENT);
+		EXPECT_FALSE(window_is_fullscreen(&window));
+		window_set_fullscreen(&window, true, 0);
+		EXPECT_TRUE(window_is_fullscreen(&window));
+		EXPECT_TRUE(window_drawable(&window) == drawable);
+		window_set_fullscreen(&window, false, WINDOW_MONITOR_CURRENT);
+		EXPECT_FALSE(window_is_fullscreen(&window));
+
+		// Leaving fullscreen on the unmapped window keeps other states
+		Display* display = window_display(&window);
+		Atom atom_state = XInternAtom(display, "_NET_WM_STATE", False);
+		Atom atom_above = XInternAtom(display, "_NET_WM_STATE_ABOVE", False);
+		XLockDisplay(display);
+		XChangeProperty(display, (Window)drawable, atom_state, XA_ATOM, 32, PropModeReplace,
+		                (unsigned char*)&atom_above, 1);
+		XUnlockDisplay(display);
+		window_set_fullscreen(&window, true, WINDOW_MONITOR_CURRENT);
+		window_set_fullscreen(&window, false, WINDOW_MONITOR_CURRENT);
+
+		Atom actual_type;
+		int actual_format;
+		unsigned long items_count = 0, bytes_after;
+		Atom* atoms = 0;
+		XLockDisplay(display);
+		XGetWindowProperty(display, (Window)drawable, atom_state, 0, 16, False, XA_ATOM, &actual_type, &actual_format,
+		                   &items_count, &bytes_after, (unsigned char**)&atoms);
+		XUnlockDisplay(display);
+		EXPECT_INTEQ((int)items_count, 1);
+		if (atoms) {
+			EXPECT_TRUE(atoms[0] == atom_above);
+			XFree(atoms);
+		}
+	}
+
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static void
+syncresize_send(window_t* window, XEvent* xevent) {
+	Display* display = window_display(window);
+	XLockDisplay(display);
+	XSendEvent(display, (Window)window_drawable(window), False, NoEventMask, xevent);
+	XFlush(display);
+	XUnlockDisplay(display);
+}
+
+static uint64_t
+syncresize_counter(window_t* window) {
+	Display* display = window_display(window);
+	XSyncValue value;
+	XSyncIntToValue(&value, 0);
+	XLockDisplay(display);
+	XSyncQueryCounter(display, (XSyncCounter)window->sync_counter, &value);
+	XUnlockDisplay(display);
+	return (uint64_t)XSyncValueLow32(value) | ((uint64_t)(uint32_t)XSyncValueHigh32(value) << 32ULL);
+}
+
+static void*
+syncresize_thread(void* arg) {
+	window_t* window = arg;
+	Display* display = window_display(window);
+	Window drawable = (Window)window_drawable(window);
+
+	thread_sleep(100);
+	event_stream_process(window_event_stream());
+
+	// Nothing to acknowledge until the window manager sends a request and configure
+	window_frame_complete(window);
+	EXPECT_UINTEQ(syncresize_counter(window), 0);
+
+	XLockDisplay(display);
+	Atom protocols = XInternAtom(display, "WM_PROTOCOLS", False);
+	Atom sync_request = XInternAtom(display, "_NET_WM_SYNC_REQUEST", False);
+	XUnlockDisplay(display);
+
+	XEvent xevent;
+	memset(&xevent, 0, sizeof(xevent));
+	xevent.xclient.type = ClientMessage;
+	xevent.xclient.display = display;
+	xevent.xclient.window = drawable;
+	xevent.xclient.message_type = protocols;
+	xevent.xclient.format = 32;
+	xevent.xclient.data.l[0] = (long)sync_request;
+	xevent.xclient.data.l[1] = CurrentTime;
+	xevent.xclient.data.l[2] = 2;
+	xevent.xclient.data.l[3] = 1;
+	syncresize_send(window, &xevent);
+
+	memset(&xevent, 0, sizeof(xevent));
+	xevent.xconfigure.type = ConfigureNotify;
+	xevent.xconfigure.display = display;
+	xevent.xconfigure.event = drawable;
+	xevent.xconfigure.window = drawable;
+	xevent.xconfigure.width = 400;
+	xevent.xconfigure.height = 300;
+	syncresize_send(window, &xevent);
+
+	bool got_resize = false;
+	tick_t start = time_current();
+	while (!got_resize && (time_elapsed_ticks(start) < time_ticks_per_second())) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if (event->id == WINDOWEVENT_RESIZE)
+				got_resize = true;
+		}
+		thread_yield();
+	}
+	EXPECT_TRUE(got_resize);
+
+	// Frame for the configured size drawn, the counter is set to the requested value
+	window_frame_complete(window);
+	EXPECT_UINTEQ(syncresize_counter(window), 2ULL | (1ULL << 32ULL));
+
+	// Acknowledged once, later frames for the same size do not touch the counter
+	XSyncValue zero;
+	XSyncIntToValue(&zero, 0);
+	XLockDisplay(display);
+	XSyncSetCounter(display, (XSyncCounter)window->sync_counter, zero);
+	XUnlockDisplay(display);
+	window_frame_complete(window);
+	EXPECT_UINTEQ(syncresize_counter(window), 0);
+
+	window_message_quit();
+
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, syncresize) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240,
+	              WINDOW_FLAG_NOSHOW | WINDOW_FLAG_SYNCRESIZE);
+	EXPECT_TRUE(window_is_open(&window));
+	if (window.wayland || !window.sync_counter) {
+		window_finalize(&window);
+		event_stream_process(window_event_stream());
+		return 0;
+	}
+
+	thread_initialize(&thread, syncresize_thread, &window, STRING_CONST("syncresize_thread"), THREAD_PRIORITY_NORMAL,
+	                  0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static char title_written[64];
+
+static void*
+title_thread(void* arg) {
+	window_t* window = arg;
+
+	// Only the latest of a burst of updates is written
+	char buffer[64];
+	for (unsigned int iupdate = 0; iupdate < 100; ++iupdate) {
+		string_t title = string_format(buffer, sizeof(buffer), STRING_CONST("Title \xc3\xa5 %u"), iupdate);
+		window_set_title(window, STRING_ARGS(title));
+	}
+	thread_sleep(100);
+
+	Display* display = window_display(window);
+	Atom atom_name = XInternAtom(display, "_NET_WM_NAME", False);
+	Atom actual_type;
+	int actual_format;
+	unsigned long items_count, bytes_after;
+	unsigned char* data = 0;
+	XLockDisplay(display);
+	XGetWindowProperty(display, (Window)window_drawable(window), atom_name, 0, 16, False, AnyPropertyType,
+	                   &actual_type, &actual_format, &items_count, &bytes_after, &data);
+	XUnlockDisplay(display);
+	if (data) {
+		string_copy(title_written, sizeof(title_written), (const char*)data, items_count);
+		XFree(data);
+	}
+
+	window_message_quit();
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, title) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+
+	if (!window.wayland) {
+		title_written[0] = 0;
+		thread_initialize(&thread, title_thread, &window, STRING_CONST("title_thread"), THREAD_PRIORITY_NORMAL, 0);
+		thread_start(&thread);
+
+		EXPECT_EQ(window_message_loop(), 0);
+
+		thread_join(&thread);
+		thread_finalize(&thread);
+
+		EXPECT_TRUE(string_equal(title_written, string_length(title_written), STRING_CONST("Title \xc3\xa5 99")));
+	}
+
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+DECLARE_TEST(window, monitors) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_monitor_t monitors[16];
+	size_t count = window_monitors(monitors, 16);
+	if (!count)
+		return 0;
+	if (count > 16)
+		count = 16;
+
+	window_monitor_t primary = monitors[0];
+	unsigned int primaries = 0;
+	for (size_t imon = 0; imon < count; ++imon) {
+		EXPECT_NE(monitors[imon].width, 0);
+		EXPECT_NE(monitors[imon].height, 0);
+		EXPECT_TRUE(monitors[imon].scale >= 1.0f);
+		if (monitors[imon].primary) {
+			primary = monitors[imon];
+			++primaries;
+		}
+	}
+	EXPECT_UINTEQ(primaries, 1);
+	EXPECT_INTEQ(window_screen_width(WINDOW_ADAPTER_DEFAULT), (int)primary.width);
+	EXPECT_INTEQ(window_screen_height(WINDOW_ADAPTER_DEFAULT), (int)primary.height);
+	EXPECT_SIZEEQ(window_monitors(nullptr, 0), count);
+
+	window_t window;
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), primary.width + 100,
+	              primary.height + 100, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+	if (!window.wayland) {
+		window_fit_to_screen(&window);
+		EXPECT_TRUE(window_width(&window) <= primary.width);
+		EXPECT_TRUE(window_height(&window) <= primary.height);
+	}
+	window_finalize(&window);
+	event_stream_process(window_event_stream());
+#endif
+	return 0;
+}
+
+#if FOUNDATION_PLATFORM_LINUX
+
+static tick_t
+waylandsurface_wait(window_t* window, int id) {
+	tick_t start = time_current();
+	while (time_elapsed_ticks(start) < time_ticks_per_second() * 2) {
+		event_block_t* block = event_stream_process(window_event_stream());
+		event_t* event = 0;
+		while ((event = event_next(block, event))) {
+			if ((event->id == id) && (window_event_window(event) == window))
+				return time_elapsed_ticks(start);
+		}
+		thread_yield();
+	}
+	return -1;
+}
+
+static void*
+waylandsurface_thread(void* arg) {
+	FOUNDATION_UNUSED(arg);
+
+	// Finalize windows while the loop thread dispatches their configure and frame callbacks
+	for (int iloop = 0; iloop < 16; ++iloop) {
+		window_t* windows[4];
+		for (int iwin = 0; iwin < 4; ++iwin) {
+			windows[iwin] = window_allocate();
+			window_create(windows[iwin], WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 64, 64, 0);
+		}
+		thread_sleep((unsigned int)(iloop % 4));
+		for (int iwin = 0; iwin < 4; ++iwin)
+			window_deallocate(windows[iwin]);
+	}
+	event_stream_process(window_event_stream());
+
+	// A surface handed over through window_drawable keeps the client's buffers on configure
+	window_t* window = window_allocate();
+	window_create(window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 320, 240, 0);
+	bool drawable = (window_drawable(window) != 0);
+	tick_t show = waylandsurface_wait(window, WINDOWEVENT_SHOW);
+	window_resize(window, 200, 150);
+	tick_t resize = waylandsurface_wait(window, WINDOWEVENT_RESIZE);
+	bool buffer = (window->wl_buffer != nullptr);
+	window_deallocate(window);
+
+	window_message_quit();
+
+	EXPECT_TRUE(drawable);
+	EXPECT_TRUE(show >= 0);
+	EXPECT_TRUE(resize >= 0);
+	EXPECT_FALSE(buffer);
+
+	return 0;
+}
+
+#endif
+
+DECLARE_TEST(window, waylandsurface) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_t window;
+	thread_t thread;
+
+	test_set_fail_hook(on_test_fail);
+
+	window_create(&window, WINDOW_ADAPTER_DEFAULT, STRING_CONST("Window test"), 64, 64, WINDOW_FLAG_NOSHOW);
+	EXPECT_TRUE(window_is_open(&window));
+	if (!window.wayland) {
+		window_finalize(&window);
+		return 0;
+	}
+
+	thread_initialize(&thread, waylandsurface_thread, 0, STRING_CONST("waylandsurface_thread"), THREAD_PRIORITY_NORMAL,
+	                  0);
+	thread_start(&thread);
+
+	EXPECT_EQ(window_message_loop(), 0);
+
+	void* ret = thread_join(&thread);
+
+	window_finalize(&window);
+	thread_finalize(&thread);
+	event_stream_process(window_event_stream());
+
+	if (ret)
+		return ret;
+#endif
+	return 0;
+}
+
 static void
 test_window_declare(void) {
 	ADD_TEST(window, createdestroy);
 	ADD_TEST(window, sizemove);
+	ADD_TEST(window, eventstats);
+	ADD_TEST(window, eventring);
+	ADD_TEST(window, subscribe);
+	ADD_TEST(window, callback);
+	ADD_TEST(window, zeroalloc);
+	ADD_TEST(window, errorstats);
+	ADD_TEST(window, createasync);
+	ADD_TEST(window, createchild);
+	ADD_TEST(window, inputmask);
+	ADD_TEST(window, keyevent);
+	ADD_TEST(window, pointerevent);
+	ADD_TEST(window, cursorlock);
+	ADD_TEST(window, fullscreen);
+	ADD_TEST(window, syncresize);
+	ADD_TEST(window, title);
+	ADD_TEST(window, monitors);
+	ADD_TEST(window, waylandsurface);
 }
 
 static test_suite_t test_window_suite = {test_window_application,
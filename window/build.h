@@ -32,3 +32,23 @@
 #define WINDOW_API extern
 #endif
 #endif
+
+//! Enable native Wayland backend on Linux, selected at runtime (requires wayland-client)
+#ifndef WINDOW_ENABLE_WAYLAND
+#define WINDOW_ENABLE_WAYLAND 0
+#endif
+
+//! Enable XInput2 precise and raw pointer input on Linux (requires libXi)
+#ifndef WINDOW_ENABLE_XINPUT2
+#define WINDOW_ENABLE_XINPUT2 0
+#endif
+
+//! Enable XRandR monitor enumeration and change notifications on Linux (requires libXrandr)
+#ifndef WINDOW_ENABLE_XRANDR
+#define WINDOW_ENABLE_XRANDR 0
+#endif
+
+//! Enable hot path instrumentation collected through window_stats_get
+#ifndef WINDOW_ENABLE_STATISTICS
+#define WINDOW_ENABLE_STATISTICS 0
+#endif
@@ -15,9 +15,13 @@
 #include <window/internal.h>
 
 #include <foundation/array.h>
+#include <foundation/atomic.h>
 #include <foundation/event.h>
 #include <foundation/semaphore.h>
 #include <foundation/log.h>
+#include <foundation/mutex.h>
+#include <foundation/thread.h>
+#include <foundation/time.h>
 
 #if FOUNDATION_PLATFORM_WINDOWS
 #include <foundation/windows.h>
@@ -26,6 +30,79 @@
 tick_t window_event_token;
 
 static event_stream_t* window_stream = 0;
+static window_event_ring_t* window_ring = 0;
+
+typedef struct window_subscription_t window_subscription_t;
+
+struct window_subscription_t {
+	window_t* window;
+	unsigned int mask;
+	window_event_ring_t* ring;
+};
+
+typedef struct window_callback_t window_callback_t;
+
+struct window_callback_t {
+	window_t* window;
+	window_event_id id;
+	window_event_fn callback;
+	void* userdata;
+};
+
+typedef struct window_callback_deferred_t window_callback_deferred_t;
+
+struct window_callback_deferred_t {
+	window_callback_t callback;
+	window_handle_t handle;
+	size_t offset;
+	size_t size;
+};
+
+#define WINDOW_CALLBACK_DISPATCH_LIMIT 8
+
+static window_callback_t* window_callbacks;
+static atomic32_t window_callback_count;
+
+// Callbacks for events posted by the deferring thread, with copies of the payloads. Only accessed by that thread
+static window_callback_deferred_t* window_callback_deferred;
+static uint8_t* window_callback_payload;
+
+static window_subscription_t* window_subscriptions;
+static atomic32_t window_subscription_count;
+static mutex_t* window_dispatch_lock;
+
+FOUNDATION_ALIGNED_STRUCT(window_event_ring_t, 64) {
+	// Positions on separate cache lines to avoid false sharing between writers and readers
+	FOUNDATION_ALIGN(64) atomic32_t write;
+	FOUNDATION_ALIGN(64) atomic32_t read;
+	FOUNDATION_ALIGN(64) uint32_t mask;
+	window_event_record_t* record;
+};
+
+static size_t window_event_capacity;
+static window_event_overflow window_event_policy;
+static unsigned int window_event_timeout;
+
+static atomic64_t window_event_posted[WINDOWEVENT_COUNT];
+static atomic64_t window_event_dropped[WINDOWEVENT_COUNT];
+static atomic64_t window_event_bytes;
+static atomic64_t window_event_high_water;
+static atomic64_t window_event_blocked;
+static atomic64_t window_event_blocked_time;
+static atomic64_t window_event_timeouts;
+static atomic64_t window_event_since;
+
+// Stream depth is counted from bytes admitted to the stream and bytes handed to the consumer. The consumer
+// swaps the stream blocks in event_stream_process, which flips the stream write index. A flip seen since the
+// last check hands every event admitted before it to the consumer, regardless of how the stream is drained
+static atomic64_t window_event_queued;
+static atomic64_t window_event_consumed;
+static atomic32_t window_event_write;
+
+// Thread posting with the display locked, its BLOCK waits are deferred to window_event_backpressure and its
+// callbacks to window_event_dispatch_deferred
+static atomic64_t window_event_defer_thread;
+static atomic32_t window_event_deferred;
 
 bool window_app_started = false;
 bool window_app_paused = true;
@@ -36,8 +113,29 @@ static window_t** windows;
 #endif
 
 int
-window_event_initialize(void) {
-	window_stream = event_stream_allocate(1024);
+window_event_initialize(const window_config_t* config) {
+	window_event_capacity = config->event_stream_capacity ? config->event_stream_capacity : 1024;
+	window_event_policy = config->event_overflow;
+	window_event_timeout = config->event_overflow_timeout ? config->event_overflow_timeout : 100;
+	window_event_stats_reset();
+	atomic_store64(&window_event_queued, 0, memory_order_relaxed);
+	atomic_store64(&window_event_consumed, 0, memory_order_relaxed);
+	atomic_store64(&window_event_defer_thread, 0, memory_order_relaxed);
+	atomic_store32(&window_event_deferred, 0, memory_order_relaxed);
+
+	window_stream = event_stream_allocate(window_event_capacity);
+	atomic_store32(&window_event_write, atomic_load32(&window_stream->write, memory_order_acquire),
+	               memory_order_relaxed);
+	if (config->event_ring_capacity)
+		window_ring = window_event_ring_allocate(config->event_ring_capacity);
+
+	window_dispatch_lock = mutex_allocate(STRING_CONST("window_event_dispatch"));
+	window_subscriptions = 0;
+	atomic_store32(&window_subscription_count, 0, memory_order_release);
+	window_callbacks = 0;
+	atomic_store32(&window_callback_count, 0, memory_order_release);
+	window_callback_deferred = 0;
+	window_callback_payload = 0;
 	window_event_token = 1;
 #if FOUNDATION_PLATFORM_LINUX
 	semaphore_initialize(&windows_lock, 1);
@@ -52,14 +150,215 @@ window_event_finalize(void) {
 	array_deallocate(windows);
 	semaphore_finalize(&windows_lock);
 #endif
+	for (size_t isub = 0, ssize = array_size(window_subscriptions); isub < ssize; ++isub)
+		window_event_ring_deallocate(window_subscriptions[isub].ring);
+	array_deallocate(window_subscriptions);
+	atomic_store32(&window_subscription_count, 0, memory_order_release);
+	array_deallocate(window_callbacks);
+	atomic_store32(&window_callback_count, 0, memory_order_release);
+	array_deallocate(window_callback_deferred);
+	array_deallocate(window_callback_payload);
+	mutex_deallocate(window_dispatch_lock);
+	window_dispatch_lock = nullptr;
+
+	window_event_ring_deallocate(window_ring);
+	window_ring = nullptr;
 	event_stream_deallocate(window_stream);
 	window_stream = nullptr;
 }
 
+static size_t
+window_event_depth(void) {
+	// Index 2 marks the stream locked by a poster or a swap in progress. Two flips between checks look
+	// like none, until the next flip the depth is overestimated, so it is advisory
+	int32_t write = atomic_load32(&window_stream->write, memory_order_acquire);
+	int32_t seen = atomic_load32(&window_event_write, memory_order_relaxed);
+	if ((write < 2) && (write != seen) &&
+	    atomic_cas32(&window_event_write, write, seen, memory_order_relaxed, memory_order_relaxed))
+		atomic_store64(&window_event_consumed, atomic_load64(&window_event_queued, memory_order_relaxed),
+		               memory_order_release);
+	int64_t consumed = atomic_load64(&window_event_consumed, memory_order_acquire);
+	int64_t queued = atomic_load64(&window_event_queued, memory_order_relaxed);
+	return (queued > consumed) ? (size_t)(queued - consumed) : 0;
+}
+
+// Wait until the consumer brings the stream below capacity or the timeout expires
+static void
+window_event_block(size_t event_size) {
+	tick_t start = time_current();
+	tick_t limit = (time_ticks_per_second() * (tick_t)window_event_timeout) / 1000;
+	atomic_add64(&window_event_blocked, 1, memory_order_relaxed);
+	while ((window_event_depth() + event_size) > window_event_capacity) {
+		if (time_elapsed_ticks(start) >= limit) {
+			atomic_add64(&window_event_timeouts, 1, memory_order_relaxed);
+			break;
+		}
+		thread_sleep(1);
+	}
+	atomic_add64(&window_event_blocked_time, time_elapsed_ticks(start), memory_order_relaxed);
+}
+
+static void
+window_event_max(atomic64_t* max, int64_t value) {
+	int64_t current = atomic_load64(max, memory_order_relaxed);
+	while ((value > current) && !atomic_cas64(max, value, current, memory_order_relaxed, memory_order_relaxed))
+		current = atomic_load64(max, memory_order_relaxed);
+}
+
+//! Apply the overflow policy and record telemetry, returns false if the event should be dropped
+static bool
+window_event_admit(window_event_id id, bool motion, size_t size) {
+	// Matches the event block layout of an event header followed by payload padded to 8 bytes
+	size_t event_size = sizeof(event_t) + ((size + 7) & ~(size_t)7);
+	size_t depth = window_event_depth() + event_size;
+	// Unknown identifiers are counted in the unused zero slot
+	size_t slot = ((unsigned int)id < WINDOWEVENT_COUNT) ? (size_t)id : 0;
+	if (depth > window_event_capacity) {
+		if (window_event_policy == WINDOW_EVENT_OVERFLOW_DROP_MOTION) {
+			bool pointer = (id == WINDOWEVENT_POINTERMOVE) || (id == WINDOWEVENT_POINTERPRECISE) ||
+			               (id == WINDOWEVENT_POINTERRAW);
+			if (pointer || ((id == WINDOWEVENT_NATIVE) && (motion || (depth > window_event_capacity * 2)))) {
+				atomic_add64(&window_event_dropped[slot], 1, memory_order_relaxed);
+				return false;
+			}
+		} else if (window_event_policy == WINDOW_EVENT_OVERFLOW_BLOCK) {
+			if ((uint64_t)atomic_load64(&window_event_defer_thread, memory_order_relaxed) == thread_id()) {
+				// Posted with the display locked, wait once after the loop releases it
+				atomic_store32(&window_event_deferred, 1, memory_order_relaxed);
+			} else {
+				window_event_block(event_size);
+				depth = window_event_depth() + event_size;
+			}
+		}
+	}
+	window_event_max(&window_event_high_water, (int64_t)depth);
+	atomic_add64(&window_event_posted[slot], 1, memory_order_relaxed);
+	atomic_add64(&window_event_bytes, (int64_t)event_size, memory_order_relaxed);
+	atomic_add64(&window_event_queued, (int64_t)event_size, memory_order_relaxed);
+	return true;
+}
+
+void
+window_event_defer_block(void) {
+	atomic_store64(&window_event_defer_thread, (int64_t)thread_id(), memory_order_relaxed);
+}
+
+void
+window_event_defer_end(void) {
+	window_event_dispatch_deferred();
+	atomic_store64(&window_event_defer_thread, 0, memory_order_relaxed);
+}
+
+void
+window_event_backpressure(void) {
+	if (atomic_cas32(&window_event_deferred, 0, 1, memory_order_relaxed, memory_order_relaxed))
+		window_event_block(0);
+}
+
+static void
+window_event_post_ring(window_event_id id, window_t* window, const void* payload, size_t size) {
+	size_t slot = ((unsigned int)id < WINDOWEVENT_COUNT) ? (size_t)id : 0;
+	if (!window_event_ring_write(window_ring, id, window, payload, size)) {
+		atomic_add64(&window_event_dropped[slot], 1, memory_order_relaxed);
+		return;
+	}
+	size_t depth = window_event_ring_size(window_ring) * sizeof(window_event_record_t);
+	window_event_max(&window_event_high_water, (int64_t)depth);
+	atomic_add64(&window_event_posted[slot], 1, memory_order_relaxed);
+	atomic_add64(&window_event_bytes, (int64_t)sizeof(window_event_record_t), memory_order_relaxed);
+}
+
+static void
+window_event_post_subscriptions(window_event_id id, window_t* window, const void* payload, size_t size) {
+	unsigned int bit = WINDOW_EVENT_MASK(id);
+	mutex_lock(window_dispatch_lock);
+	for (size_t isub = 0, ssize = array_size(window_subscriptions); isub < ssize; ++isub) {
+		window_subscription_t* subscription = window_subscriptions + isub;
+		if ((subscription->window == window) && (subscription->mask & bit)) {
+			if (!window_event_ring_write(subscription->ring, id, window, payload, size))
+				atomic_add64(&window_event_dropped[((unsigned int)id < WINDOWEVENT_COUNT) ? id : 0], 1,
+				             memory_order_relaxed);
+		}
+	}
+	mutex_unlock(window_dispatch_lock);
+}
+
+static void
+window_event_dispatch(window_event_id id, window_t* window, const void* native, size_t size) {
+	// Collect under the lock and invoke outside it, so callbacks can modify the callback table
+	window_callback_t dispatch[WINDOW_CALLBACK_DISPATCH_LIMIT];
+	size_t count = 0;
+	mutex_lock(window_dispatch_lock);
+	for (size_t icb = 0, csize = array_size(window_callbacks); icb < csize; ++icb) {
+		window_callback_t* callback = window_callbacks + icb;
+		if ((callback->window == window) && (callback->id == id) && (count < WINDOW_CALLBACK_DISPATCH_LIMIT))
+			dispatch[count++] = *callback;
+	}
+	mutex_unlock(window_dispatch_lock);
+	if (!count)
+		return;
+
+	if ((uint64_t)atomic_load64(&window_event_defer_thread, memory_order_relaxed) == thread_id()) {
+		// Posted with the display locked, invoke from window_event_dispatch_deferred once the loop releases it.
+		// Native events live on the loop stack, keep a copy of the payload until then
+		size_t offset = array_size(window_callback_payload);
+		if (native && size) {
+			array_resize(window_callback_payload, offset + size);
+			memcpy(window_callback_payload + offset, native, size);
+		} else {
+			size = 0;
+		}
+		for (size_t icb = 0; icb < count; ++icb) {
+			window_callback_deferred_t deferred = {dispatch[icb], window ? window_handle(window) : 0, offset, size};
+			array_push(window_callback_deferred, deferred);
+		}
+		return;
+	}
+
+	for (size_t icb = 0; icb < count; ++icb)
+		dispatch[icb].callback(window, id, native, dispatch[icb].userdata);
+}
+
+void
+window_event_dispatch_deferred(void) {
+	size_t csize = array_size(window_callback_deferred);
+	if (!csize)
+		return;
+	// The display lock is released, events posted by the callbacks are dispatched directly
+	int64_t thread = atomic_load64(&window_event_defer_thread, memory_order_relaxed);
+	atomic_store64(&window_event_defer_thread, 0, memory_order_relaxed);
+	for (size_t icb = 0; icb < csize; ++icb) {
+		window_callback_deferred_t* deferred = window_callback_deferred + icb;
+		window_callback_t* callback = &deferred->callback;
+		// Skip windows finalized since the event was posted
+		if (callback->window && (window_handle_resolve(deferred->handle) != callback->window))
+			continue;
+		const void* native = deferred->size ? window_callback_payload + deferred->offset : nullptr;
+		callback->callback(callback->window, callback->id, native, callback->userdata);
+	}
+	array_clear(window_callback_deferred);
+	array_clear(window_callback_payload);
+	atomic_store64(&window_event_defer_thread, thread, memory_order_relaxed);
+}
+
 void
 window_event_post(window_event_id id, window_t* window) {
-	if (window_stream)
-		event_post(window_stream, (int)id, 0, 0, &window, sizeof(window_t*));
+	window_event_post_payload(id, window, nullptr, 0);
+}
+
+void
+window_event_post_payload(window_event_id id, window_t* window, const void* payload, size_t size) {
+	WINDOW_STATS_POST(id);
+	if (atomic_load32(&window_callback_count, memory_order_acquire))
+		window_event_dispatch(id, window, payload, size);
+	// Only pay for the subscription lock when there are subscribers
+	if (atomic_load32(&window_subscription_count, memory_order_acquire))
+		window_event_post_subscriptions(id, window, payload, size);
+	if (window_ring)
+		window_event_post_ring(id, window, payload, size);
+	else if (window_stream && window_event_admit(id, false, sizeof(window_t*) + size))
+		event_post_varg(window_stream, (int)id, window_handle(window), 0, &window, sizeof(window_t*), payload, size,
+		                nullptr, nullptr);
 }
 
 #if FOUNDATION_PLATFORM_WINDOWS
@@ -67,9 +366,20 @@ window_event_post(window_event_id id, window_t* window) {
 void
 window_event_post_native(window_event_id id, window_t* window, void* hwnd, uintptr_t msg, uintptr_t wparam,
                          uintptr_t lparam, void* buffer, size_t size) {
-	if (window_stream)
-		event_post_varg(window_stream, (int)id, 0, 0, &window, sizeof(window_t*), &hwnd, sizeof(void*), &msg,
-		                sizeof(uintptr_t), &wparam, sizeof(uintptr_t), &lparam, sizeof(uintptr_t),
+	WINDOW_STATS_POST(id);
+	if (atomic_load32(&window_callback_count, memory_order_acquire)) {
+		MSG native;
+		memset(&native, 0, sizeof(native));
+		native.hwnd = (HWND)hwnd;
+		native.message = (UINT)msg;
+		native.wParam = (WPARAM)wparam;
+		native.lParam = (LPARAM)lparam;
+		window_event_dispatch(id, window, &native, sizeof(native));
+	}
+	size_t payload_size = sizeof(window_t*) + sizeof(void*) + sizeof(uintptr_t) * 3 + size;
+	if (window_stream && window_event_admit(id, (msg == WM_MOUSEMOVE), payload_size))
+		event_post_varg(window_stream, (int)id, window_handle(window), 0, &window, sizeof(window_t*), &hwnd,
+		                sizeof(void*), &msg, sizeof(uintptr_t), &wparam, sizeof(uintptr_t), &lparam, sizeof(uintptr_t),
 		                size ? buffer : nullptr, size, nullptr, nullptr);
 }
 
@@ -77,9 +387,15 @@ window_event_post_native(window_event_id id, window_t* window, void* hwnd, uintp
 
 void
 window_event_post_native(window_event_id id, window_t* window, void* xevent) {
-	if (window_stream)
-		event_post_varg(window_stream, (int)id, 0, 0, &window, sizeof(window_t*), xevent, sizeof(XEvent), nullptr,
-		                nullptr);
+	WINDOW_STATS_POST(id);
+	int type = ((XEvent*)xevent)->type;
+	WINDOW_STATS_NATIVE(type);
+	if (atomic_load32(&window_callback_count, memory_order_acquire))
+		window_event_dispatch(id, window, xevent, sizeof(XEvent));
+	// Native events carry the full XEvent which does not fit a ring record, always use the stream
+	if (window_stream && window_event_admit(id, (type == MotionNotify), sizeof(window_t*) + sizeof(XEvent)))
+		event_post_varg(window_stream, (int)id, window_handle(window), 0, &window, sizeof(window_t*), xevent,
+		                sizeof(XEvent), nullptr, nullptr);
 }
 
 #endif
@@ -89,11 +405,314 @@ window_event_window(const event_t* event) {
 	return *(const window_t* const*)&event->payload[0];
 }
 
+window_handle_t
+window_event_window_handle(const event_t* event) {
+	return (window_handle_t)event->object;
+}
+
+const window_key_event_t*
+window_event_key(const event_t* event) {
+	return (const window_key_event_t*)(const void*)&event->payload[sizeof(window_t*)];
+}
+
+const window_text_event_t*
+window_event_text(const event_t* event) {
+	return (const window_text_event_t*)(const void*)&event->payload[sizeof(window_t*)];
+}
+
+const window_pointer_event_t*
+window_event_pointer(const event_t* event) {
+	return (const window_pointer_event_t*)(const void*)&event->payload[sizeof(window_t*)];
+}
+
+const window_pointer_precise_event_t*
+window_event_pointer_precise(const event_t* event) {
+	return (const window_pointer_precise_event_t*)(const void*)&event->payload[sizeof(window_t*)];
+}
+
+const window_pointer_raw_event_t*
+window_event_pointer_raw(const event_t* event) {
+	return (const window_pointer_raw_event_t*)(const void*)&event->payload[sizeof(window_t*)];
+}
+
 event_stream_t*
 window_event_stream(void) {
 	return window_stream;
 }
 
+window_event_ring_t*
+window_event_ring(void) {
+	return window_ring;
+}
+
+static FOUNDATION_FORCEINLINE int32_t
+window_event_ring_offset(int32_t position, size_t offset) {
+	// Positions wrap around, keep the arithmetic unsigned
+	return (int32_t)((uint32_t)position + (uint32_t)offset);
+}
+
+window_event_ring_t*
+window_event_ring_allocate(size_t capacity) {
+	uint32_t size = 2;
+	while ((size < capacity) && (size < (1U << 30)))
+		size <<= 1;
+	window_event_ring_t* ring =
+	    memory_allocate(HASH_WINDOW, sizeof(window_event_ring_t) + (sizeof(window_event_record_t) * size), 64,
+	                    MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	ring->mask = size - 1;
+	ring->record = (window_event_record_t*)(void*)(ring + 1);
+	for (uint32_t islot = 0; islot < size; ++islot)
+		atomic_store32(&ring->record[islot].sequence, (int32_t)islot, memory_order_relaxed);
+	atomic_store32(&ring->write, 0, memory_order_relaxed);
+	atomic_store32(&ring->read, 0, memory_order_release);
+	return ring;
+}
+
+void
+window_event_ring_deallocate(window_event_ring_t* ring) {
+	memory_deallocate(ring);
+}
+
+bool
+window_event_ring_write(window_event_ring_t* ring, window_event_id id, window_t* window, const void* payload,
+                        size_t size) {
+	if (size > WINDOW_EVENT_RECORD_PAYLOAD)
+		return false;
+
+	// Claim a slot, a slot is free for position N when its sequence equals N
+	window_event_record_t* record;
+	int32_t position = atomic_load32(&ring->write, memory_order_relaxed);
+	while (true) {
+		record = ring->record + ((uint32_t)position & ring->mask);
+		int32_t sequence = atomic_load32(&record->sequence, memory_order_acquire);
+		int32_t diff = (int32_t)((uint32_t)sequence - (uint32_t)position);
+		if (diff == 0) {
+			if (atomic_cas32(&ring->write, window_event_ring_offset(position, 1), position, memory_order_relaxed,
+			                 memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		}
+		position = atomic_load32(&ring->write, memory_order_relaxed);
+	}
+
+	record->id = (int32_t)id;
+	record->window = window;
+	record->handle = window_handle(window);
+	record->timestamp = time_current();
+	record->size = (uint32_t)size;
+	if (size)
+		memcpy(record->payload, payload, size);
+
+	// Publish, the slot is readable for position N when its sequence equals N + 1
+	atomic_store32(&record->sequence, window_event_ring_offset(position, 1), memory_order_release);
+	return true;
+}
+
+size_t
+window_event_ring_acquire(window_event_ring_t* ring, window_event_record_t** records, size_t max) {
+	int32_t position = atomic_load32(&ring->read, memory_order_relaxed);
+	uint32_t first = (uint32_t)position & ring->mask;
+	size_t contiguous = (size_t)(ring->mask + 1 - first);
+	if (max > contiguous)
+		max = contiguous;
+
+	size_t count = 0;
+	while (count < max) {
+		int32_t sequence = atomic_load32(&ring->record[first + count].sequence, memory_order_acquire);
+		if (sequence != window_event_ring_offset(position, count + 1))
+			break;
+		++count;
+	}
+	*records = ring->record + first;
+	return count;
+}
+
+void
+window_event_ring_release(window_event_ring_t* ring, size_t count) {
+	int32_t position = atomic_load32(&ring->read, memory_order_relaxed);
+	for (size_t irecord = 0; irecord < count; ++irecord) {
+		int32_t slot = window_event_ring_offset(position, irecord);
+		atomic_store32(&ring->record[(uint32_t)slot & ring->mask].sequence,
+		               window_event_ring_offset(slot, ring->mask + 1), memory_order_release);
+	}
+	atomic_store32(&ring->read, window_event_ring_offset(position, count), memory_order_release);
+}
+
+bool
+window_event_ring_read(window_event_ring_t* ring, window_event_record_t* record) {
+	window_event_record_t* source;
+	int32_t position = atomic_load32(&ring->read, memory_order_relaxed);
+	while (true) {
+		source = ring->record + ((uint32_t)position & ring->mask);
+		int32_t sequence = atomic_load32(&source->sequence, memory_order_acquire);
+		int32_t diff = (int32_t)((uint32_t)sequence - (uint32_t)window_event_ring_offset(position, 1));
+		if (diff == 0) {
+			if (atomic_cas32(&ring->read, window_event_ring_offset(position, 1), position, memory_order_relaxed,
+			                 memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		}
+		position = atomic_load32(&ring->read, memory_order_relaxed);
+	}
+
+	record->id = source->id;
+	record->window = source->window;
+	record->handle = source->handle;
+	record->timestamp = source->timestamp;
+	record->size = source->size;
+	if (source->size)
+		memcpy(record->payload, source->payload, source->size);
+
+	atomic_store32(&source->sequence, window_event_ring_offset(position, ring->mask + 1), memory_order_release);
+	return true;
+}
+
+size_t
+window_event_ring_size(window_event_ring_t* ring) {
+	// Read position first, it never passes the write position
+	int32_t read = atomic_load32(&ring->read, memory_order_acquire);
+	int32_t write = atomic_load32(&ring->write, memory_order_acquire);
+	return (size_t)((uint32_t)write - (uint32_t)read);
+}
+
+void
+window_event_set_callback(window_t* window, window_event_id id, window_event_fn callback, void* userdata) {
+	mutex_lock(window_dispatch_lock);
+	size_t icb = 0, csize = array_size(window_callbacks);
+	for (; icb < csize; ++icb) {
+		if ((window_callbacks[icb].window == window) && (window_callbacks[icb].id == id))
+			break;
+	}
+	if (icb < csize) {
+		if (callback) {
+			window_callbacks[icb].callback = callback;
+			window_callbacks[icb].userdata = userdata;
+		} else {
+			array_erase(window_callbacks, icb);
+		}
+	} else if (callback) {
+		window_callback_t entry = {window, id, callback, userdata};
+		array_push(window_callbacks, entry);
+	}
+	atomic_store32(&window_callback_count, (int32_t)array_size(window_callbacks), memory_order_release);
+	mutex_unlock(window_dispatch_lock);
+
+#if FOUNDATION_PLATFORM_LINUX
+	window_native_input_update(window);
+#endif
+}
+
+unsigned int
+window_event_input(window_t* window) {
+	unsigned int mask = 0;
+	mutex_lock(window_dispatch_lock);
+	for (size_t icb = 0, csize = array_size(window_callbacks); icb < csize; ++icb) {
+		if (window_callbacks[icb].window == window)
+			mask |= WINDOW_EVENT_MASK(window_callbacks[icb].id);
+	}
+	for (size_t isub = 0, ssize = array_size(window_subscriptions); isub < ssize; ++isub) {
+		if (window_subscriptions[isub].window == window)
+			mask |= window_subscriptions[isub].mask;
+	}
+	mutex_unlock(window_dispatch_lock);
+
+	// Native event callbacks cannot tell which input they want
+	unsigned int input = 0;
+	if (mask & WINDOW_EVENT_MASK(WINDOWEVENT_NATIVE))
+		input |= WINDOW_INPUT_ALL;
+	if (mask & (WINDOW_EVENT_MASK(WINDOWEVENT_KEYDOWN) | WINDOW_EVENT_MASK(WINDOWEVENT_KEYUP) |
+	            WINDOW_EVENT_MASK(WINDOWEVENT_TEXT)))
+		input |= WINDOW_INPUT_KEYBOARD;
+	if (mask & WINDOW_EVENT_MASK(WINDOWEVENT_POINTERMOVE))
+		input |= WINDOW_INPUT_MOTION;
+	if (mask & (WINDOW_EVENT_MASK(WINDOWEVENT_POINTERBUTTON) | WINDOW_EVENT_MASK(WINDOWEVENT_POINTERWHEEL)))
+		input |= WINDOW_INPUT_BUTTON;
+	if (mask & (WINDOW_EVENT_MASK(WINDOWEVENT_POINTERPRECISE) | WINDOW_EVENT_MASK(WINDOWEVENT_POINTERSCROLL)))
+		input |= WINDOW_INPUT_PRECISE;
+	if (mask & WINDOW_EVENT_MASK(WINDOWEVENT_POINTERRAW))
+		input |= WINDOW_INPUT_RAW;
+	return input;
+}
+
+window_event_ring_t*
+window_event_subscribe(window_t* window, unsigned int mask, size_t capacity) {
+	window_subscription_t subscription;
+	subscription.window = window;
+	subscription.mask = mask & ~WINDOW_EVENT_MASK(WINDOWEVENT_NATIVE);
+	subscription.ring = window_event_ring_allocate(capacity ? capacity : 256);
+
+	mutex_lock(window_dispatch_lock);
+	array_push(window_subscriptions, subscription);
+	atomic_store32(&window_subscription_count, (int32_t)array_size(window_subscriptions), memory_order_release);
+	mutex_unlock(window_dispatch_lock);
+
+#if FOUNDATION_PLATFORM_LINUX
+	window_native_input_update(window);
+#endif
+
+	return subscription.ring;
+}
+
+void
+window_event_unsubscribe(window_event_ring_t* ring) {
+	if (!ring)
+		return;
+	window_t* window = 0;
+	mutex_lock(window_dispatch_lock);
+	for (size_t isub = 0, ssize = array_size(window_subscriptions); isub < ssize; ++isub) {
+		if (window_subscriptions[isub].ring == ring) {
+			window = window_subscriptions[isub].window;
+			array_erase(window_subscriptions, isub);
+			break;
+		}
+	}
+	atomic_store32(&window_subscription_count, (int32_t)array_size(window_subscriptions), memory_order_release);
+	mutex_unlock(window_dispatch_lock);
+
+#if FOUNDATION_PLATFORM_LINUX
+	if (window)
+		window_native_input_update(window);
+#endif
+
+	// No writer can reference the ring once removed under the lock
+	window_event_ring_deallocate(ring);
+}
+
+void
+window_event_stats(window_event_stats_t* stats) {
+	memset(stats, 0, sizeof(window_event_stats_t));
+	for (size_t iid = 0; iid < WINDOWEVENT_COUNT; ++iid) {
+		stats->posted[iid] = (uint64_t)atomic_load64(&window_event_posted[iid], memory_order_relaxed);
+		stats->dropped[iid] = (uint64_t)atomic_load64(&window_event_dropped[iid], memory_order_relaxed);
+	}
+	stats->bytes = (uint64_t)atomic_load64(&window_event_bytes, memory_order_relaxed);
+	stats->depth = window_stream ? window_event_depth() : 0;
+	if (window_ring)
+		stats->depth += window_event_ring_size(window_ring) * sizeof(window_event_record_t);
+	stats->high_water = (size_t)atomic_load64(&window_event_high_water, memory_order_relaxed);
+	stats->capacity = window_event_capacity;
+	stats->blocked = (uint64_t)atomic_load64(&window_event_blocked, memory_order_relaxed);
+	stats->blocked_time = atomic_load64(&window_event_blocked_time, memory_order_relaxed);
+	stats->timeouts = (uint64_t)atomic_load64(&window_event_timeouts, memory_order_relaxed);
+	stats->elapsed = time_elapsed_ticks(atomic_load64(&window_event_since, memory_order_relaxed));
+}
+
+void
+window_event_stats_reset(void) {
+	for (size_t iid = 0; iid < WINDOWEVENT_COUNT; ++iid) {
+		atomic_store64(&window_event_posted[iid], 0, memory_order_relaxed);
+		atomic_store64(&window_event_dropped[iid], 0, memory_order_relaxed);
+	}
+	atomic_store64(&window_event_bytes, 0, memory_order_relaxed);
+	atomic_store64(&window_event_high_water, 0, memory_order_relaxed);
+	atomic_store64(&window_event_blocked, 0, memory_order_relaxed);
+	atomic_store64(&window_event_blocked_time, 0, memory_order_relaxed);
+	atomic_store64(&window_event_timeouts, 0, memory_order_relaxed);
+	atomic_store64(&window_event_since, time_current(), memory_order_relaxed);
+}
+
 void
 window_event_handle(event_t* event) {
 	if (event->id == FOUNDATIONEVENT_START) {
@@ -21,21 +21,165 @@
 WINDOW_API void
 window_event_post(window_event_id id, window_t* window);
 
+/*! Post an event carrying a typed payload, for example window_key_event_t. Payloads delivered
+through event rings are limited to WINDOW_EVENT_RECORD_PAYLOAD bytes
+\param id Event identifier
+\param window Window
+\param payload Payload following the window pointer in the event
+\param size Size of payload */
+WINDOW_API void
+window_event_post_payload(window_event_id id, window_t* window, const void* payload, size_t size);
+
 WINDOW_API event_stream_t*
 window_event_stream(void);
 
+/*! Get window event stream telemetry
+\param stats Telemetry structure to fill */
+WINDOW_API void
+window_event_stats(window_event_stats_t* stats);
+
+/*! Reset window event stream telemetry counters and high-water mark */
+WINDOW_API void
+window_event_stats_reset(void);
+
+/*! Get the typed event ring window events are delivered through, if enabled in window_config_t
+\return Event ring, null if not enabled */
+WINDOW_API window_event_ring_t*
+window_event_ring(void);
+
+/*! Allocate a typed event ring. Any number of threads can write, consumers either drain in bulk
+through window_event_ring_acquire/window_event_ring_release from a single thread, or read single
+records through window_event_ring_read from any number of threads. Do not mix the two on the same ring.
+\param capacity Number of records, rounded up to a power of two
+\return New event ring */
+WINDOW_API window_event_ring_t*
+window_event_ring_allocate(size_t capacity);
+
+/*! Deallocate a typed event ring
+\param ring Event ring */
+WINDOW_API void
+window_event_ring_deallocate(window_event_ring_t* ring);
+
+/*! Write an event record to the ring
+\param ring Event ring
+\param id Event identifier
+\param window Window
+\param payload Inline payload, can be null
+\param size Size of payload, at most WINDOW_EVENT_RECORD_PAYLOAD bytes
+\return true if written, false if the ring is full or payload too large */
+WINDOW_API bool
+window_event_ring_write(window_event_ring_t* ring, window_event_id id, window_t* window, const void* payload,
+                        size_t size);
+
+/*! Acquire a contiguous run of pending records without copying. Single consumer only. Records
+stay valid until released with window_event_ring_release
+\param ring Event ring
+\param records Receives pointer to first record
+\param max Maximum number of records to acquire
+\return Number of records acquired, zero if ring is empty */
+WINDOW_API size_t
+window_event_ring_acquire(window_event_ring_t* ring, window_event_record_t** records, size_t max);
+
+/*! Release records previously acquired, making the slots available to writers
+\param ring Event ring
+\param count Number of records to release */
+WINDOW_API void
+window_event_ring_release(window_event_ring_t* ring, size_t count);
+
+/*! Copy the next pending record out of the ring. Safe for multiple consumers
+\param ring Event ring
+\param record Receives record
+\return true if a record was read, false if ring is empty */
+WINDOW_API bool
+window_event_ring_read(window_event_ring_t* ring, window_event_record_t* record);
+
+/*! Get the number of pending records in the ring
+\param ring Event ring
+\return Number of pending records */
+WINDOW_API size_t
+window_event_ring_size(window_event_ring_t* ring);
+
+/*! Subscribe to events for a single window. Events matching the mask are written to a dedicated
+event ring in addition to the shared event stream, so a consumer only sees its own window. Native
+events do not fit a ring record and are never delivered to subscriptions. The ring is valid until
+passed to window_event_unsubscribe, which should be done no later than the window destroy event.
+\param window Window
+\param mask Event mask, combination of WINDOW_EVENT_MASK bits
+\param capacity Number of records in the ring, zero for default (256)
+\return Event ring receiving the subscribed events, drained with the window_event_ring functions */
+WINDOW_API window_event_ring_t*
+window_event_subscribe(window_t* window, unsigned int mask, size_t capacity);
+
+/*! Remove a subscription and deallocate the event ring
+\param ring Event ring returned from window_event_subscribe */
+WINDOW_API void
+window_event_unsubscribe(window_event_ring_t* ring);
+
+/*! Set a callback for an event on a window, replacing any previous callback for the same window and
+event. Callbacks for events posted by other threads are invoked synchronously on the posting thread,
+before the event is queued to the event stream. Callbacks for events originating from the windowing
+system are invoked on the thread running window_message_loop once it has processed the pending native
+events and released the display lock, before it waits for more, so a REDRAW can be serviced before the
+window manager shows the new size. Callbacks must not block. Removing or replacing a callback does not
+wait for an invocation already started on another thread, keep the user data valid until the window
+is destroyed or the message loop has exited.
+\param window Window
+\param id Event identifier
+\param callback Callback, null to remove
+\param userdata User data passed to callback */
+WINDOW_API void
+window_event_set_callback(window_t* window, window_event_id id, window_event_fn callback, void* userdata);
+
 /*! Handle foundation events. Do not pass in events from any other
 event namespace to this function.
 \param event Foundation event */
 WINDOW_API void
 window_event_handle(event_t* event);
 
-/*! Get window related to the event
+/*! Get window related to the event. The pointer is not checked and dangles if the window was
+finalized before the event was processed, see window_event_window_handle
 \param event Window event
 \return Window */
 WINDOW_API const window_t*
 window_event_window(const event_t* event);
 
+/*! Get handle of the window related to the event. Resolve with window_handle_resolve, which
+returns null if the window was finalized after the event was posted
+\param event Window event
+\return Window handle */
+WINDOW_API window_handle_t
+window_event_window_handle(const event_t* event);
+
+/*! Get key data of a WINDOWEVENT_KEYDOWN or WINDOWEVENT_KEYUP event
+\param event Window event
+\return Key data */
+WINDOW_API const window_key_event_t*
+window_event_key(const event_t* event);
+
+/*! Get text of a WINDOWEVENT_TEXT event
+\param event Window event
+\return Text data */
+WINDOW_API const window_text_event_t*
+window_event_text(const event_t* event);
+
+/*! Get pointer data of a WINDOWEVENT_POINTERMOVE, WINDOWEVENT_POINTERBUTTON or WINDOWEVENT_POINTERWHEEL event
+\param event Window event
+\return Pointer data */
+WINDOW_API const window_pointer_event_t*
+window_event_pointer(const event_t* event);
+
+/*! Get pointer data of a WINDOWEVENT_POINTERPRECISE or WINDOWEVENT_POINTERSCROLL event
+\param event Window event
+\return Precise pointer data */
+WINDOW_API const window_pointer_precise_event_t*
+window_event_pointer_precise(const event_t* event);
+
+/*! Get pointer data of a WINDOWEVENT_POINTERRAW event
+\param event Window event
+\return Raw pointer data */
+WINDOW_API const window_pointer_raw_event_t*
+window_event_pointer_raw(const event_t* event);
+
 #if FOUNDATION_PLATFORM_WINDOWS
 
 WINDOW_API void
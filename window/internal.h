@@ -28,13 +28,118 @@
 #endif
 
 WINDOW_EXTERN int
-window_event_initialize(void);
+window_event_initialize(const window_config_t* config);
 
 WINDOW_EXTERN void
 window_event_finalize(void);
 
 WINDOW_EXTERN tick_t window_event_token;
 
+//! Defer WINDOW_EVENT_OVERFLOW_BLOCK waits and event callbacks for events posted from the calling thread, for
+//  message loops posting with the display locked. The wait is applied once by window_event_backpressure and the
+//  callbacks are invoked by window_event_dispatch_deferred
+WINDOW_EXTERN void
+window_event_defer_block(void);
+
+//! Stop deferring for the calling thread and invoke any callbacks still deferred. Called when the message
+//  loop exits
+WINDOW_EXTERN void
+window_event_defer_end(void);
+
+//! Invoke callbacks for events posted from the deferring thread since the last call. Called by the message
+//  loop after releasing the display lock
+WINDOW_EXTERN void
+window_event_dispatch_deferred(void);
+
+//! Wait for the consumer if events posted from the deferring thread overflowed the stream. Called by the
+//  message loop after releasing the display lock
+WINDOW_EXTERN void
+window_event_backpressure(void);
+
+//! Input categories enabled on new windows, from window_config_t
+WINDOW_EXTERN unsigned int window_input_default;
+
+//! Input categories (WINDOW_INPUT_* flags) needed by event subscriptions and callbacks for the window
+WINDOW_EXTERN unsigned int
+window_event_input(window_t* window);
+
+WINDOW_EXTERN int
+window_handle_initialize(void);
+
+WINDOW_EXTERN void
+window_handle_finalize(void);
+
+WINDOW_EXTERN int
+window_pool_initialize(const window_config_t* config);
+
+WINDOW_EXTERN void
+window_pool_finalize(void);
+
+//! Allocate zero initialized window storage, from the pool if enabled
+WINDOW_EXTERN window_t*
+window_pool_allocate(void);
+
+//! Free window storage allocated with window_pool_allocate
+WINDOW_EXTERN void
+window_pool_deallocate(window_t* window);
+
+//! Allocate a handle for the window, must be called before the window posts events
+WINDOW_EXTERN void
+window_handle_acquire(window_t* window);
+
+//! Invalidate the handle of the window, must be called after the window posts the destroy event
+WINDOW_EXTERN void
+window_handle_release(window_t* window);
+
+#if WINDOW_ENABLE_STATISTICS
+
+WINDOW_EXTERN void
+window_stats_record_call(window_stats_call call);
+
+WINDOW_EXTERN void
+window_stats_record_roundtrip(window_stats_call call, unsigned int count);
+
+WINDOW_EXTERN void
+window_stats_record_lock_acquired(window_stats_lock lock, tick_t wait_start);
+
+WINDOW_EXTERN void
+window_stats_record_lock_released(window_stats_lock lock);
+
+WINDOW_EXTERN void
+window_stats_record_loop(unsigned int events, tick_t process_start);
+
+WINDOW_EXTERN void
+window_stats_record_native(int type);
+
+WINDOW_EXTERN void
+window_stats_record_post(window_event_id id);
+
+#define WINDOW_STATS_CALL(call) window_stats_record_call(call)
+#define WINDOW_STATS_ROUNDTRIP(call, count) window_stats_record_roundtrip(call, count)
+#define WINDOW_STATS_LOOP(events, start) window_stats_record_loop(events, start)
+#define WINDOW_STATS_NATIVE(type) window_stats_record_native(type)
+#define WINDOW_STATS_POST(id) window_stats_record_post(id)
+
+#else
+
+#define WINDOW_STATS_CALL(call) \
+	do {                        \
+	} while (0)
+#define WINDOW_STATS_ROUNDTRIP(call, count) \
+	do {                                    \
+	} while (0)
+#define WINDOW_STATS_LOOP(events, start) \
+	do {                                 \
+	} while (0)
+#define WINDOW_STATS_NATIVE(type) \
+	do {                          \
+	} while (0)
+#define WINDOW_STATS_POST(id) \
+	do {                      \
+	} while (0)
+
+#endif
+
 #if FOUNDATION_PLATFORM_MACOS || FOUNDATION_PLATFORM_IOS
 
 WINDOW_EXTERN void
@@ -45,12 +150,73 @@ window_class_reference(void);
 #if FOUNDATION_PLATFORM_LINUX || FOUNDATION_PLATFORM_APPLE
 
 WINDOW_EXTERN void
-window_native_initialize(void);
+window_native_initialize(const window_config_t* config);
 
 WINDOW_EXTERN void
 window_native_finalize(void);
 
 #endif
 
+#if FOUNDATION_PLATFORM_LINUX
+
+//! Reselect native input for the window after the enabled or requested input changed
+WINDOW_EXTERN void
+window_native_input_update(window_t* window);
+
+#endif
+
+#if FOUNDATION_PLATFORM_LINUX && WINDOW_ENABLE_WAYLAND
+
+WINDOW_EXTERN bool
+window_wayland_initialize(size_t capacity);
+
+WINDOW_EXTERN void
+window_wayland_finalize(void);
+
+WINDOW_EXTERN void
+window_wayland_create(window_t* window, const char* title, size_t length, unsigned int width, unsigned int height,
+                      unsigned int flags);
+
+WINDOW_EXTERN void
+window_wayland_finalize_window(window_t* window);
+
+WINDOW_EXTERN void
+window_wayland_maximize(window_t* window);
+
+WINDOW_EXTERN void
+window_wayland_minimize(window_t* window);
+
+WINDOW_EXTERN void
+window_wayland_restore(window_t* window);
+
+WINDOW_EXTERN bool
+window_wayland_is_maximized(window_t* window);
+
+WINDOW_EXTERN void
+window_wayland_set_fullscreen(window_t* window, bool fullscreen);
+
+WINDOW_EXTERN bool
+window_wayland_is_fullscreen(window_t* window);
+
+WINDOW_EXTERN void
+window_wayland_resize(window_t* window, int width, int height);
+
+WINDOW_EXTERN void
+window_wayland_set_title(window_t* window, const char* title, size_t length);
+
+WINDOW_EXTERN void*
+window_wayland_surface(window_t* window);
+
+WINDOW_EXTERN size_t
+window_wayland_monitors(window_monitor_t* monitors, size_t capacity);
+
+WINDOW_EXTERN int
+window_wayland_message_loop(void);
+
+WINDOW_EXTERN void
+window_wayland_message_quit(void);
+
+#endif
+
 WINDOW_EXTERN bool window_app_started;
 WINDOW_EXTERN bool window_app_paused;
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <foundation/platform.h>
+#include <foundation/types.h>
 
 #include <window/build.h>
 #include <window/hashstrings.h>
@@ -44,49 +45,511 @@ typedef enum window_event_id {
 	/*! Window needs to be redrawn */
 	WINDOWEVENT_REDRAW,
 	/*! Native event */
-	WINDOWEVENT_NATIVE
+	WINDOWEVENT_NATIVE,
+	/*! Key pressed or repeated, payload is window_key_event_t */
+	WINDOWEVENT_KEYDOWN,
+	/*! Key released, payload is window_key_event_t */
+	WINDOWEVENT_KEYUP,
+	/*! Text input, payload is window_text_event_t */
+	WINDOWEVENT_TEXT,
+	/*! Pointer moved, payload is window_pointer_event_t. Motion is compressed to the latest position
+	per message loop wake-up, see window_pointer_history for all samples */
+	WINDOWEVENT_POINTERMOVE,
+	/*! Pointer button pressed or released, payload is window_pointer_event_t */
+	WINDOWEVENT_POINTERBUTTON,
+	/*! Pointer wheel scrolled, payload is window_pointer_event_t */
+	WINDOWEVENT_POINTERWHEEL,
+	/*! Pointer moved with subpixel precision, payload is window_pointer_precise_event_t. Requires
+	WINDOW_INPUT_PRECISE, compressed like WINDOWEVENT_POINTERMOVE */
+	WINDOWEVENT_POINTERPRECISE,
+	/*! Smooth scroll, payload is window_pointer_precise_event_t. Requires WINDOW_INPUT_PRECISE */
+	WINDOWEVENT_POINTERSCROLL,
+	/*! Unaccelerated relative device motion, payload is window_pointer_raw_event_t. Requires
+	WINDOW_INPUT_RAW, accumulated per message loop wake-up */
+	WINDOWEVENT_POINTERRAW,
+	/*! Monitors were added, removed or reconfigured, window is null. The monitor cache is already
+	updated when the event is posted, see window_monitors */
+	WINDOWEVENT_MONITORS_CHANGED,
+	/*! Number of event identifiers, not an actual event */
+	WINDOWEVENT_COUNT
 } window_event_id;
 
+//! Bit for the given event identifier in an event subscription mask
+#define WINDOW_EVENT_MASK(id) (1U << (unsigned int)(id))
+//! Event subscription mask for all events
+#define WINDOW_EVENT_MASK_ALL 0xFFFFFFFFU
+
+/*! Public API functions tracked by the statistics, see window_stats_get */
+typedef enum window_stats_call {
+	WINDOW_STATS_CALL_CREATE = 0,
+	WINDOW_STATS_CALL_FINALIZE,
+	WINDOW_STATS_CALL_MAXIMIZE,
+	WINDOW_STATS_CALL_MINIMIZE,
+	WINDOW_STATS_CALL_RESTORE,
+	WINDOW_STATS_CALL_RESIZE,
+	WINDOW_STATS_CALL_MOVE,
+	WINDOW_STATS_CALL_IS_MAXIMIZED,
+	WINDOW_STATS_CALL_IS_MINIMIZED,
+	WINDOW_STATS_CALL_HAS_FOCUS,
+	WINDOW_STATS_CALL_WIDTH,
+	WINDOW_STATS_CALL_HEIGHT,
+	WINDOW_STATS_CALL_POSITION_X,
+	WINDOW_STATS_CALL_POSITION_Y,
+	WINDOW_STATS_CALL_MESSAGE_QUIT,
+	WINDOW_STATS_CALL_COUNT
+} window_stats_call;
+
+/*! Locks tracked by the statistics */
+typedef enum window_stats_lock {
+	/*! Native display lock (XLockDisplay) */
+	WINDOW_STATS_LOCK_DISPLAY = 0,
+	/*! Window list mutex */
+	WINDOW_STATS_LOCK_WINDOW_LIST,
+	WINDOW_STATS_LOCK_COUNT
+} window_stats_lock;
+
+#define WINDOW_STATS_NATIVE_EVENT_TYPES 64
+
+/*! Policy applied when the window event stream reaches its configured capacity */
+typedef enum window_event_overflow {
+	/*! Let the event stream grow to fit all events */
+	WINDOW_EVENT_OVERFLOW_GROW = 0,
+	/*! Drop new motion events while the stream is over capacity, then all new native events at twice the
+	capacity. Events already queued are kept, so the newest motion is dropped rather than the oldest. State
+	events (create, close, focus, ...) are never dropped */
+	WINDOW_EVENT_OVERFLOW_DROP_MOTION,
+	/*! Block the posting thread until the consumer processes the stream or the timeout expires,
+	after which the event is posted anyway. The message loop posts the events of one wake-up and waits
+	once after releasing the display lock */
+	WINDOW_EVENT_OVERFLOW_BLOCK
+} window_event_overflow;
+
 #define WINDOW_ADAPTER_DEFAULT ((unsigned int)-1)
 
+//! Monitor currently containing the window, for window_set_fullscreen
+#define WINDOW_MONITOR_CURRENT ((unsigned int)-1)
+
 #define WINDOW_FLAG_NOSHOW 0x0001
 #define WINDOW_FLAG_NOSYSTEMMENU 0x0002
 #define WINDOW_FLAG_FULLSCREEN 0x0004
 #define WINDOW_FLAG_NORESIZE 0x0008
+//! Throttle interactive resizes to the drawing rate, see window_frame_complete
+#define WINDOW_FLAG_SYNCRESIZE 0x0010
+
+//! Modifier flags in window_key_event_t
+#define WINDOW_MODIFIER_SHIFT 0x0001
+#define WINDOW_MODIFIER_CONTROL 0x0002
+#define WINDOW_MODIFIER_ALT 0x0004
+#define WINDOW_MODIFIER_SUPER 0x0008
+#define WINDOW_MODIFIER_CAPSLOCK 0x0010
+#define WINDOW_MODIFIER_NUMLOCK 0x0020
+
+//! Native input event categories, see window_input_enable
+#define WINDOW_INPUT_KEYBOARD 0x0001
+#define WINDOW_INPUT_BUTTON 0x0002
+#define WINDOW_INPUT_MOTION 0x0004
+#define WINDOW_INPUT_CROSSING 0x0008
+//! All core input categories, precise and raw input must be enabled explicitly
+#define WINDOW_INPUT_ALL 0x000F
+//! Subpixel motion and smooth scrolling through XInput2, replaces core motion on the window
+#define WINDOW_INPUT_PRECISE 0x0010
+//! Unaccelerated relative motion through XInput2, delivered to the focused window
+#define WINDOW_INPUT_RAW 0x0020
+//! No input on new windows in window_config_t::input_default, since zero selects the default
+#define WINDOW_INPUT_NONE 0x8000
+
+#define WINDOW_EVENT_RECORD_PAYLOAD 24
+
+//! Number of X11 error codes and request opcodes tracked in window_error_stats_t
+#define WINDOW_ERROR_CODES 256
+
+//! Generation checked window handle, index in low 32 bits and generation in high 32 bits
+typedef uint64_t window_handle_t;
+
+#define WINDOW_HANDLE_INVALID ((window_handle_t)0)
 
 typedef struct window_config_t window_config_t;
+typedef struct window_stats_t window_stats_t;
+typedef struct window_event_stats_t window_event_stats_t;
+typedef struct window_error_stats_t window_error_stats_t;
+typedef struct window_event_record_t window_event_record_t;
+typedef struct window_event_ring_t window_event_ring_t;
+typedef struct window_create_info_t window_create_info_t;
+typedef struct window_key_event_t window_key_event_t;
+typedef struct window_text_event_t window_text_event_t;
+typedef struct window_pointer_event_t window_pointer_event_t;
+typedef struct window_pointer_sample_t window_pointer_sample_t;
+typedef struct window_pointer_history_t window_pointer_history_t;
+typedef struct window_pointer_precise_event_t window_pointer_precise_event_t;
+typedef struct window_pointer_raw_event_t window_pointer_raw_event_t;
+typedef struct window_input_state_t window_input_state_t;
+typedef struct window_monitor_t window_monitor_t;
 typedef struct window_t window_t;
 
 struct window_config_t {
-	int unused;
+	/*! Capacity of the window event stream in bytes, also the threshold for the overflow
+	policy. Posting does not allocate while the consumer keeps pending events within the capacity.
+	Zero selects the default of 1024 bytes */
+	size_t event_stream_capacity;
+	/*! Policy when the event stream reaches capacity */
+	window_event_overflow event_overflow;
+	/*! Timeout in milliseconds for WINDOW_EVENT_OVERFLOW_BLOCK, zero selects the default of 100ms */
+	unsigned int event_overflow_timeout;
+	/*! Number of records in the typed event ring, rounded up to a power of two. Zero disables
+	the ring. When enabled, window events are delivered through window_event_ring instead of the
+	event stream, while native events still go through the event stream */
+	size_t event_ring_capacity;
+	/*! Number of cache line aligned window slots per pool slab. Zero disables the pool and windows
+	are allocated individually */
+	size_t window_pool_capacity;
+	/*! Expected number of windows, used to preallocate the window lists so that adding windows
+	does not allocate. Zero selects the default of 16 */
+	size_t window_capacity;
+	/*! Minimum interval in milliseconds between windowing system errors reported with a resolved
+	stack trace, other errors are only counted. Zero selects the default of 1000ms */
+	unsigned int error_trace_interval;
+	/*! Native input categories (WINDOW_INPUT_* flags) enabled on new windows. Zero selects the
+	default of WINDOW_INPUT_ALL. WINDOW_INPUT_NONE only selects input the window requests through
+	window_input_enable or event callbacks, so the windowing system does not send input events
+	nobody consumes */
+	unsigned int input_default;
+};
+
+/*! Parameters for one window in window_create_batch */
+struct window_create_info_t {
+	/*! Screen, WINDOW_ADAPTER_DEFAULT for default screen */
+	unsigned int adapter;
+	/*! Window title */
+	const char* title;
+	/*! Length of title */
+	size_t length;
+	/*! Width in pixels */
+	unsigned int width;
+	/*! Height in pixels */
+	unsigned int height;
+	/*! Window flags */
+	unsigned int flags;
+};
+
+/*! Payload of key events */
+struct window_key_event_t {
+	/*! Symbol of the key with the current modifiers applied (X11 keysym) */
+	uint32_t symbol;
+	/*! Native key code */
+	uint32_t keycode;
+	/*! Active modifiers, combination of WINDOW_MODIFIER_* flags */
+	uint32_t modifiers;
+	/*! Nonzero for repeated key down events of a held key */
+	uint32_t repeat;
+};
+
+#define WINDOW_TEXT_EVENT_LENGTH 20
+
+/*! Payload of text events, long input is split over several events */
+struct window_text_event_t {
+	/*! Length of text in bytes */
+	uint32_t length;
+	/*! UTF-8 text, not zero terminated */
+	char text[WINDOW_TEXT_EVENT_LENGTH];
+};
+
+/*! Payload of pointer events */
+struct window_pointer_event_t {
+	/*! Horizontal position in window */
+	int32_t x;
+	/*! Vertical position in window */
+	int32_t y;
+	/*! Active modifiers, combination of WINDOW_MODIFIER_* flags */
+	uint32_t modifiers;
+	/*! Button for button events, 1 left, 2 middle, 3 right, higher as numbered by the windowing system */
+	uint32_t button;
+	/*! Horizontal wheel steps for wheel events, positive right */
+	int16_t wheel_x;
+	/*! Vertical wheel steps for wheel events, positive up */
+	int16_t wheel_y;
+	/*! Nonzero if button was pressed, zero if released */
+	uint16_t pressed;
+	/*! Number of motion samples compressed into a move event */
+	uint16_t samples;
+};
+
+/*! Payload of precise pointer events, fits an event ring record */
+struct window_pointer_precise_event_t {
+	/*! Horizontal position in window with subpixel precision */
+	float x;
+	/*! Vertical position in window with subpixel precision */
+	float y;
+	/*! Horizontal scroll in wheel steps for scroll events, positive right */
+	float scroll_x;
+	/*! Vertical scroll in wheel steps for scroll events, positive up */
+	float scroll_y;
+	/*! Server timestamp in milliseconds */
+	uint32_t time;
+	/*! Source device identifier */
+	uint16_t device;
+	/*! Number of motion samples compressed into a move event */
+	uint16_t samples;
+};
+
+/*! Payload of raw pointer events */
+struct window_pointer_raw_event_t {
+	/*! Accumulated unaccelerated horizontal motion in device units */
+	float dx;
+	/*! Accumulated unaccelerated vertical motion in device units */
+	float dy;
+	/*! Server timestamp in milliseconds of the latest sample */
+	uint32_t time;
+	/*! Source device identifier */
+	uint16_t device;
+	/*! Number of device samples accumulated */
+	uint16_t samples;
+};
+
+/*! Input state of a window, see window_input_snapshot. Only reflects input categories selected
+for the window */
+struct window_input_state_t {
+	/*! Keys held, bit (code & 7) of byte (code >> 3) for key code, see window_key_code */
+	uint8_t keys[32];
+	/*! Pointer buttons held, bit (N - 1) for button N */
+	uint32_t buttons;
+	/*! Active modifiers, combination of WINDOW_MODIFIER_* flags */
+	uint32_t modifiers;
+	/*! Horizontal pointer position in window */
+	int32_t x;
+	/*! Vertical pointer position in window */
+	int32_t y;
+	/*! Total horizontal wheel steps since the window was created, positive right */
+	double wheel_x;
+	/*! Total vertical wheel steps since the window was created, positive up */
+	double wheel_y;
+	/*! Number of state updates published, unchanged if nothing happened between two snapshots */
+	uint32_t sequence;
+	/*! Reserved */
+	uint32_t reserved;
+};
+
+/*! Monitor geometry, see window_monitors */
+struct window_monitor_t {
+	/*! Horizontal position in the screen */
+	int32_t x;
+	/*! Vertical position in the screen */
+	int32_t y;
+	/*! Width in pixels */
+	uint32_t width;
+	/*! Height in pixels */
+	uint32_t height;
+	/*! Physical width in millimeters, zero if unknown */
+	uint32_t width_mm;
+	/*! Physical height in millimeters, zero if unknown */
+	uint32_t height_mm;
+	/*! Refresh rate in Hz, zero if unknown */
+	float refresh_rate;
+	/*! Horizontal dots per inch from the physical size, 96 if unknown */
+	float dpi;
+	/*! Scale relative to 96 dpi in steps of 0.25, at least 1 */
+	float scale;
+	/*! Windowing system identifier of the monitor output */
+	uint32_t id;
+	/*! Nonzero for the primary monitor */
+	uint32_t primary;
+	/*! Output name, zero terminated */
+	char name[28];
+};
+
+/*! Pointer motion sample in the window pointer history */
+struct window_pointer_sample_t {
+	/*! Time the sample was received */
+	tick_t timestamp;
+	/*! Windowing system timestamp in milliseconds */
+	uint32_t time;
+	/*! Active modifiers, combination of WINDOW_MODIFIER_* flags */
+	uint32_t modifiers;
+	/*! Horizontal position in window */
+	int32_t x;
+	/*! Vertical position in window */
+	int32_t y;
+};
+
+/*! Fixed size event record in a window event ring, one cache line */
+FOUNDATION_ALIGNED_STRUCT(window_event_record_t, 64) {
+	/*! Slot sequence, internal to the ring */
+	atomic32_t sequence;
+	/*! Event identifier */
+	int32_t id;
+	/*! Window */
+	window_t* window;
+	/*! Window handle */
+	window_handle_t handle;
+	/*! Time the event was posted */
+	tick_t timestamp;
+	/*! Size of inline payload in bytes */
+	uint32_t size;
+	/*! Reserved */
+	uint32_t reserved;
+	/*! Inline payload */
+	uint8_t payload[WINDOW_EVENT_RECORD_PAYLOAD];
+};
+
+/*! Window event stream telemetry, see window_event_stats */
+struct window_event_stats_t {
+	/*! Number of events posted per event identifier */
+	uint64_t posted[WINDOWEVENT_COUNT];
+	/*! Number of events dropped by the overflow policy per event identifier */
+	uint64_t dropped[WINDOWEVENT_COUNT];
+	/*! Total number of bytes posted, including event headers */
+	uint64_t bytes;
+	/*! Current number of bytes pending in the stream, not yet handed to the consumer */
+	size_t depth;
+	/*! Largest number of bytes pending in the stream */
+	size_t high_water;
+	/*! Configured capacity in bytes */
+	size_t capacity;
+	/*! Number of posts that blocked on a full stream */
+	uint64_t blocked;
+	/*! Total time producers spent blocked, in ticks */
+	tick_t blocked_time;
+	/*! Number of blocked posts that timed out */
+	uint64_t timeouts;
+	/*! Time since last reset in ticks, for computing rates */
+	tick_t elapsed;
+};
+
+/*! Windowing system (X11) error counters, see window_error_stats */
+struct window_error_stats_t {
+	/*! Total number of errors */
+	uint64_t total;
+	/*! Number of errors per error code */
+	uint64_t code[WINDOW_ERROR_CODES];
+	/*! Number of errors per major request opcode */
+	uint64_t request[WINDOW_ERROR_CODES];
+	/*! Number of errors reported with a resolved stack trace */
+	uint64_t traced;
+	/*! Number of errors only counted due to the trace rate limit */
+	uint64_t suppressed;
+	/*! Number of traces lost because the error ring was full */
+	uint64_t dropped;
+	/*! Error code of last error */
+	unsigned int last_code;
+	/*! Major request opcode of last error */
+	unsigned int last_request;
+	/*! Minor request opcode of last error */
+	unsigned int last_minor;
+	/*! Resource identifier of last error */
+	unsigned long last_resource;
+};
+
+/*! Instrumentation counters, only collected when built with WINDOW_ENABLE_STATISTICS.
+Times are in ticks, see time_ticks_per_second */
+struct window_stats_t {
+	/*! Number of calls per public API function */
+	uint64_t calls[WINDOW_STATS_CALL_COUNT];
+	/*! Number of windowing system round-trips per public API function, counting each call that waits
+	for a reply (XSync, XGet*, XTranslateCoordinates and similar) as one */
+	uint64_t roundtrips[WINDOW_STATS_CALL_COUNT];
+	/*! Number of acquisitions per lock */
+	uint64_t lock_count[WINDOW_STATS_LOCK_COUNT];
+	/*! Total time spent waiting to acquire lock */
+	tick_t lock_wait[WINDOW_STATS_LOCK_COUNT];
+	/*! Longest single wait to acquire lock */
+	tick_t lock_wait_max[WINDOW_STATS_LOCK_COUNT];
+	/*! Total time lock was held */
+	tick_t lock_hold[WINDOW_STATS_LOCK_COUNT];
+	/*! Longest single hold of lock */
+	tick_t lock_hold_max[WINDOW_STATS_LOCK_COUNT];
+	/*! Number of message loop wake-ups */
+	uint64_t loop_wakeups;
+	/*! Number of native events processed by message loop */
+	uint64_t loop_events;
+	/*! Largest number of native events processed in a single wake-up */
+	uint64_t loop_events_max;
+	/*! Total time spent processing native events in message loop */
+	tick_t loop_time;
+	/*! Distribution of native event types processed (types beyond the range are counted in the last slot) */
+	uint64_t native_events[WINDOW_STATS_NATIVE_EVENT_TYPES];
+	/*! Distribution of window events posted */
+	uint64_t posted_events[WINDOWEVENT_COUNT];
+	/*! Timestamp of last reset */
+	tick_t since;
 };
 
 struct window_t {
+	// Fields touched by the message loop for every event are kept first, in the same cache line
+	window_handle_t handle;
+	tick_t last_paint;
+	tick_t last_resize;
+	unsigned int flags;
+	unsigned int input;
+	bool is_visible;
 #if FOUNDATION_PLATFORM_WINDOWS
-	unsigned int adapter;
+	bool created;
+	bool is_resizing;
 	void* hwnd;
+	unsigned int adapter;
 	void* instance;
-	bool created;
 	bool cursor_lock;
 	int cursor_pos_x;
 	int cursor_pos_y;
 	unsigned int wstyle;
-	bool is_resizing;
 #elif FOUNDATION_PLATFORM_MACOS
 	void* nswindow;
 	void* delegate;
 #elif FOUNDATION_PLATFORM_LINUX
-	unsigned int adapter;
 	bool created;
+	bool focus;
+	bool visible;
+	bool mapped;
+	bool create_pending;
+	bool input_context_pending;
+	bool wayland;
 	Display* display;
-	unsigned int screen;
-	XVisualInfo* visual;
 	Window drawable;
+	int width;
+	int height;
+	// Fields touched per input event, in the cache lines following the first
+	bool input_dirty;
+	bool cursor_lock;
+	bool cursor_grabbed;
 	Atom atom_delete;
-	XIM xim;
 	XIC xic;
-	bool focus;
-	bool visible;
+	window_pointer_history_t* pointer_history;
+	window_input_state_t input_live;
+	// Cold fields, touched by API calls, once per loop wake-up or by rare events
+	unsigned int adapter;
+	unsigned int screen;
+	XVisualInfo* visual;
+	Colormap colormap;
+	bool shared_visual;
+	bool fullscreen;
+	bool cursor_hidden;
+	bool sync_requested;
+	bool sync_pending;
+	window_t* parent;
+	window_t** children;
+	long event_mask;
+	unsigned int xi_input;
+	unsigned long sync_counter;
+	uint64_t sync_request;
+	uint64_t sync_value;
+	atomic32_t title_dirty;
+	size_t title_length;
+	char* title_buffer;
+	atomic32_t input_sequence;
+	window_input_state_t input_published[2];
+	XIM xim;
+	void* wl_display;
+	void* wl_surface;
+	void* xdg_surface;
+	void* xdg_toplevel;
+	void* wl_frame;
+	void* wl_buffer;
+	void* shm_data;
+	size_t shm_size;
+	int configure_width;
+	int configure_height;
+	unsigned int configure_serial;
+	unsigned int configure_state;
+	bool configure_pending;
+	bool wl_external;
 #elif FOUNDATION_PLATFORM_IOS
 	void* uiwindow;
 	unsigned int tag;
@@ -96,10 +559,6 @@ struct window_t {
 	int height;
 	void* native;
 #endif
-	unsigned int flags;
-	bool is_visible;
-	tick_t last_paint;
-	tick_t last_resize;
 };
 
 #if FOUNDATION_PLATFORM_MACOS
@@ -151,3 +610,11 @@ IB_DESIGNABLE
 #endif
 
 typedef void (*window_draw_fn)(window_t* window);
+
+/*! Window event callback
+\param window Window
+\param id Event identifier
+\param native Native event for WINDOWEVENT_NATIVE, the payload for events carrying one (see
+window_key_event_t and window_text_event_t), null for other events
+\param userdata User data given when registering the callback */
+typedef void (*window_event_fn)(window_t* window, window_event_id id, const void* native, void* userdata);
@@ -19,48 +19,583 @@
 
 static bool window_initialized = false;
 
+unsigned int window_input_default;
+
+#define WINDOW_HANDLE_CHUNK_BITS 8
+#define WINDOW_HANDLE_CHUNK_SIZE (1U << WINDOW_HANDLE_CHUNK_BITS)
+#define WINDOW_HANDLE_CHUNK_LIMIT 4096
+
+typedef struct window_handle_slot_t window_handle_slot_t;
+
+struct window_handle_slot_t {
+	atomic32_t generation;
+	uint32_t next_free;
+	atomicptr_t window;
+};
+
+// Slots are allocated in chunks that never move, so resolving a handle needs no lock
+static atomicptr_t window_handle_chunk[WINDOW_HANDLE_CHUNK_LIMIT];
+static uint32_t window_handle_capacity;
+static uint32_t window_handle_free;
+static mutex_t* window_handle_lock;
+
+int
+window_handle_initialize(void) {
+	window_handle_lock = mutex_allocate(STRING_CONST("window_handle"));
+	window_handle_capacity = 0;
+	window_handle_free = 0;
+	return 0;
+}
+
+void
+window_handle_finalize(void) {
+	for (uint32_t ichunk = 0; ichunk < WINDOW_HANDLE_CHUNK_LIMIT; ++ichunk) {
+		memory_deallocate(atomic_load_ptr(&window_handle_chunk[ichunk], memory_order_relaxed));
+		atomic_store_ptr(&window_handle_chunk[ichunk], nullptr, memory_order_relaxed);
+	}
+	mutex_deallocate(window_handle_lock);
+	window_handle_lock = nullptr;
+	window_handle_capacity = 0;
+	window_handle_free = 0;
+}
+
+static window_handle_slot_t*
+window_handle_slot(uint32_t index) {
+	window_handle_slot_t* chunk =
+	    atomic_load_ptr(&window_handle_chunk[index >> WINDOW_HANDLE_CHUNK_BITS], memory_order_acquire);
+	return chunk ? chunk + (index & (WINDOW_HANDLE_CHUNK_SIZE - 1)) : nullptr;
+}
+
+void
+window_handle_acquire(window_t* window) {
+	window->handle = WINDOW_HANDLE_INVALID;
+	mutex_lock(window_handle_lock);
+	if (!window_handle_free) {
+		uint32_t ichunk = window_handle_capacity >> WINDOW_HANDLE_CHUNK_BITS;
+		if (ichunk >= WINDOW_HANDLE_CHUNK_LIMIT) {
+			mutex_unlock(window_handle_lock);
+			log_error(HASH_WINDOW, ERROR_OUT_OF_MEMORY, STRING_CONST("Window handle table exhausted"));
+			return;
+		}
+		window_handle_slot_t* chunk =
+		    memory_allocate(HASH_WINDOW, sizeof(window_handle_slot_t) * WINDOW_HANDLE_CHUNK_SIZE, 0,
+		                    MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+		for (uint32_t islot = 0; islot < WINDOW_HANDLE_CHUNK_SIZE; ++islot) {
+			atomic_store32(&chunk[islot].generation, 1, memory_order_relaxed);
+			// Free list links are stored as index + 1, zero terminates
+			chunk[islot].next_free = (islot + 1 < WINDOW_HANDLE_CHUNK_SIZE) ? window_handle_capacity + islot + 2 : 0;
+		}
+		atomic_store_ptr(&window_handle_chunk[ichunk], chunk, memory_order_release);
+		window_handle_free = window_handle_capacity + 1;
+		window_handle_capacity += WINDOW_HANDLE_CHUNK_SIZE;
+	}
+
+	uint32_t index = window_handle_free - 1;
+	window_handle_slot_t* slot = window_handle_slot(index);
+	window_handle_free = slot->next_free;
+	atomic_store_ptr(&slot->window, window, memory_order_release);
+	uint32_t generation = (uint32_t)atomic_load32(&slot->generation, memory_order_relaxed);
+	mutex_unlock(window_handle_lock);
+
+	window->handle = ((window_handle_t)generation << 32) | (window_handle_t)index;
+}
+
+void
+window_handle_release(window_t* window) {
+	window_handle_t handle = window->handle;
+	window->handle = WINDOW_HANDLE_INVALID;
+	if (handle == WINDOW_HANDLE_INVALID)
+		return;
+
+	uint32_t index = (uint32_t)(handle & 0xFFFFFFFFU);
+	uint32_t generation = (uint32_t)(handle >> 32);
+	mutex_lock(window_handle_lock);
+	window_handle_slot_t* slot = (index < window_handle_capacity) ? window_handle_slot(index) : nullptr;
+	if (slot && ((uint32_t)atomic_load32(&slot->generation, memory_order_relaxed) == generation) &&
+	    (atomic_load_ptr(&slot->window, memory_order_relaxed) == window)) {
+		// Bump generation before clearing the pointer, resolve reads them in the opposite order
+		uint32_t next = generation + 1;
+		atomic_store32(&slot->generation, (int32_t)(next ? next : 1), memory_order_release);
+		atomic_store_ptr(&slot->window, nullptr, memory_order_release);
+		slot->next_free = window_handle_free;
+		window_handle_free = index + 1;
+	}
+	mutex_unlock(window_handle_lock);
+}
+
+#define WINDOW_POOL_ALIGNMENT 64
+
+static size_t window_pool_capacity;
+static size_t window_pool_stride;
+static void** window_pool_slab;
+static window_t* window_pool_free;
+static mutex_t* window_pool_lock;
+
+int
+window_pool_initialize(const window_config_t* config) {
+	window_pool_capacity = config->window_pool_capacity;
+	window_pool_stride = (sizeof(window_t) + (WINDOW_POOL_ALIGNMENT - 1)) & ~(size_t)(WINDOW_POOL_ALIGNMENT - 1);
+	window_pool_slab = 0;
+	window_pool_free = 0;
+	if (window_pool_capacity)
+		window_pool_lock = mutex_allocate(STRING_CONST("window_pool"));
+	return 0;
+}
+
+void
+window_pool_finalize(void) {
+	for (size_t islab = 0, ssize = array_size(window_pool_slab); islab < ssize; ++islab)
+		memory_deallocate(window_pool_slab[islab]);
+	array_deallocate(window_pool_slab);
+	window_pool_free = 0;
+	window_pool_capacity = 0;
+	if (window_pool_lock)
+		mutex_deallocate(window_pool_lock);
+	window_pool_lock = nullptr;
+}
+
+window_t*
+window_pool_allocate(void) {
+	if (!window_pool_capacity)
+		return memory_allocate(HASH_WINDOW, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+
+	mutex_lock(window_pool_lock);
+	if (!window_pool_free) {
+		char* slab = memory_allocate(HASH_WINDOW, window_pool_stride * window_pool_capacity,
+		                             WINDOW_POOL_ALIGNMENT, MEMORY_PERSISTENT);
+		array_push(window_pool_slab, (void*)slab);
+		// Free slots are linked through their first pointer-sized bytes
+		for (size_t islot = window_pool_capacity; islot > 0; --islot) {
+			window_t* slot = (window_t*)(void*)(slab + (window_pool_stride * (islot - 1)));
+			*(window_t**)(void*)slot = window_pool_free;
+			window_pool_free = slot;
+		}
+	}
+	window_t* window = window_pool_free;
+	window_pool_free = *(window_t**)(void*)window;
+	mutex_unlock(window_pool_lock);
+
+	memset(window, 0, sizeof(window_t));
+	return window;
+}
+
+void
+window_pool_deallocate(window_t* window) {
+	if (!window)
+		return;
+	if (!window_pool_capacity) {
+		memory_deallocate(window);
+		return;
+	}
+	mutex_lock(window_pool_lock);
+	*(window_t**)(void*)window = window_pool_free;
+	window_pool_free = window;
+	mutex_unlock(window_pool_lock);
+}
+
+window_handle_t
+window_handle(window_t* window) {
+	return window ? window->handle : WINDOW_HANDLE_INVALID;
+}
+
+window_t*
+window_handle_resolve(window_handle_t handle) {
+	uint32_t index = (uint32_t)(handle & 0xFFFFFFFFU);
+	uint32_t generation = (uint32_t)(handle >> 32);
+	if (!generation || ((index >> WINDOW_HANDLE_CHUNK_BITS) >= WINDOW_HANDLE_CHUNK_LIMIT))
+		return nullptr;
+	window_handle_slot_t* slot = window_handle_slot(index);
+	if (!slot)
+		return nullptr;
+	window_t* window = atomic_load_ptr(&slot->window, memory_order_acquire);
+	if ((uint32_t)atomic_load32(&slot->generation, memory_order_acquire) != generation)
+		return nullptr;
+	return window;
+}
+
+#if WINDOW_ENABLE_STATISTICS
+
+static struct {
+	atomic64_t calls[WINDOW_STATS_CALL_COUNT];
+	atomic64_t roundtrips[WINDOW_STATS_CALL_COUNT];
+	atomic64_t lock_count[WINDOW_STATS_LOCK_COUNT];
+	atomic64_t lock_wait[WINDOW_STATS_LOCK_COUNT];
+	atomic64_t lock_wait_max[WINDOW_STATS_LOCK_COUNT];
+	atomic64_t lock_hold[WINDOW_STATS_LOCK_COUNT];
+	atomic64_t lock_hold_max[WINDOW_STATS_LOCK_COUNT];
+	atomic64_t loop_wakeups;
+	atomic64_t loop_events;
+	atomic64_t loop_events_max;
+	atomic64_t loop_time;
+	atomic64_t native_events[WINDOW_STATS_NATIVE_EVENT_TYPES];
+	atomic64_t posted_events[WINDOWEVENT_COUNT];
+	atomic64_t since;
+} window_stats_counters;
+
+// Only accessed by the thread currently holding the lock, so protected by the lock itself
+static tick_t window_stats_lock_start[WINDOW_STATS_LOCK_COUNT];
+static unsigned int window_stats_lock_depth[WINDOW_STATS_LOCK_COUNT];
+
+static void
+window_stats_max(atomic64_t* max, int64_t value) {
+	int64_t current = atomic_load64(max, memory_order_relaxed);
+	while ((value > current) && !atomic_cas64(max, value, current, memory_order_relaxed, memory_order_relaxed))
+		current = atomic_load64(max, memory_order_relaxed);
+}
+
+void
+window_stats_record_call(window_stats_call call) {
+	atomic_add64(&window_stats_counters.calls[call], 1, memory_order_relaxed);
+}
+
+void
+window_stats_record_roundtrip(window_stats_call call, unsigned int count) {
+	atomic_add64(&window_stats_counters.roundtrips[call], (int64_t)count, memory_order_relaxed);
+}
+
+void
+window_stats_record_lock_acquired(window_stats_lock lock, tick_t wait_start) {
+	if (window_stats_lock_depth[lock]++)
+		return;
+	tick_t now = time_current();
+	tick_t wait = now - wait_start;
+	window_stats_lock_start[lock] = now;
+	atomic_add64(&window_stats_counters.lock_count[lock], 1, memory_order_relaxed);
+	atomic_add64(&window_stats_counters.lock_wait[lock], wait, memory_order_relaxed);
+	window_stats_max(&window_stats_counters.lock_wait_max[lock], wait);
+}
+
+void
+window_stats_record_lock_released(window_stats_lock lock) {
+	if (!window_stats_lock_depth[lock] || --window_stats_lock_depth[lock])
+		return;
+	tick_t hold = time_current() - window_stats_lock_start[lock];
+	atomic_add64(&window_stats_counters.lock_hold[lock], hold, memory_order_relaxed);
+	window_stats_max(&window_stats_counters.lock_hold_max[lock], hold);
+}
+
+void
+window_stats_record_loop(unsigned int events, tick_t process_start) {
+	atomic_add64(&window_stats_counters.loop_wakeups, 1, memory_order_relaxed);
+	atomic_add64(&window_stats_counters.loop_events, (int64_t)events, memory_order_relaxed);
+	atomic_add64(&window_stats_counters.loop_time, time_current() - process_start, memory_order_relaxed);
+	window_stats_max(&window_stats_counters.loop_events_max, (int64_t)events);
+}
+
+void
+window_stats_record_native(int type) {
+	if (type < 0)
+		type = 0;
+	if (type >= WINDOW_STATS_NATIVE_EVENT_TYPES)
+		type = WINDOW_STATS_NATIVE_EVENT_TYPES - 1;
+	atomic_add64(&window_stats_counters.native_events[type], 1, memory_order_relaxed);
+}
+
+void
+window_stats_record_post(window_event_id id) {
+	if ((id > 0) && (id < WINDOWEVENT_COUNT))
+		atomic_add64(&window_stats_counters.posted_events[id], 1, memory_order_relaxed);
+}
+
+static void
+window_stats_copy(uint64_t* dest, const atomic64_t* source, size_t count) {
+	for (size_t islot = 0; islot < count; ++islot)
+		dest[islot] = (uint64_t)atomic_load64(source + islot, memory_order_relaxed);
+}
+
+#endif
+
+void
+window_stats_get(window_stats_t* stats) {
+	memset(stats, 0, sizeof(window_stats_t));
+#if WINDOW_ENABLE_STATISTICS
+	window_stats_copy(stats->calls, window_stats_counters.calls, WINDOW_STATS_CALL_COUNT);
+	window_stats_copy(stats->roundtrips, window_stats_counters.roundtrips, WINDOW_STATS_CALL_COUNT);
+	window_stats_copy(stats->lock_count, window_stats_counters.lock_count, WINDOW_STATS_LOCK_COUNT);
+	for (size_t ilock = 0; ilock < WINDOW_STATS_LOCK_COUNT; ++ilock) {
+		stats->lock_wait[ilock] = atomic_load64(&window_stats_counters.lock_wait[ilock], memory_order_relaxed);
+		stats->lock_wait_max[ilock] = atomic_load64(&window_stats_counters.lock_wait_max[ilock], memory_order_relaxed);
+		stats->lock_hold[ilock] = atomic_load64(&window_stats_counters.lock_hold[ilock], memory_order_relaxed);
+		stats->lock_hold_max[ilock] = atomic_load64(&window_stats_counters.lock_hold_max[ilock], memory_order_relaxed);
+	}
+	stats->loop_wakeups = (uint64_t)atomic_load64(&window_stats_counters.loop_wakeups, memory_order_relaxed);
+	stats->loop_events = (uint64_t)atomic_load64(&window_stats_counters.loop_events, memory_order_relaxed);
+	stats->loop_events_max = (uint64_t)atomic_load64(&window_stats_counters.loop_events_max, memory_order_relaxed);
+	stats->loop_time = atomic_load64(&window_stats_counters.loop_time, memory_order_relaxed);
+	window_stats_copy(stats->native_events, window_stats_counters.native_events, WINDOW_STATS_NATIVE_EVENT_TYPES);
+	window_stats_copy(stats->posted_events, window_stats_counters.posted_events, WINDOWEVENT_COUNT);
+	stats->since = atomic_load64(&window_stats_counters.since, memory_order_relaxed);
+#endif
+}
+
+void
+window_stats_reset(void) {
+#if WINDOW_ENABLE_STATISTICS
+	// Counter block is a plain sequence of atomic counters
+	atomic64_t* counter = (atomic64_t*)&window_stats_counters;
+	for (size_t islot = 0, count = sizeof(window_stats_counters) / sizeof(atomic64_t); islot < count; ++islot)
+		atomic_store64(counter + islot, 0, memory_order_relaxed);
+	atomic_store64(&window_stats_counters.since, time_current(), memory_order_relaxed);
+#endif
+}
+
 #if FOUNDATION_PLATFORM_LINUX
 
+#define WINDOW_ERROR_RING_SIZE 64
+#define WINDOW_ERROR_FRAMES 32
+
+typedef struct window_error_record_t window_error_record_t;
+
+struct window_error_record_t {
+	atomic32_t sequence;
+	unsigned int error_code;
+	unsigned int request_code;
+	unsigned int minor_code;
+	Display* display;
+	unsigned long resource;
+	unsigned long serial;
+	size_t frame_count;
+	void* frame[WINDOW_ERROR_FRAMES];
+};
+
+// The error handler runs inside Xlib with the display locked, so it only bumps counters and, within
+// the trace rate limit, captures frames into the ring. Error text and symbols are resolved by the
+// reporter thread
+static window_error_record_t window_error_ring[WINDOW_ERROR_RING_SIZE];
+static atomic32_t window_error_write;
+static int32_t window_error_read;
+static atomic64_t window_error_total;
+static atomic64_t window_error_code[WINDOW_ERROR_CODES];
+static atomic64_t window_error_request[WINDOW_ERROR_CODES];
+static atomic64_t window_error_traced;
+static atomic64_t window_error_suppressed;
+static atomic64_t window_error_dropped;
+static atomic64_t window_error_last;
+static atomic64_t window_error_last_trace;
+static tick_t window_error_interval;
+static semaphore_t window_error_signal;
+static atomic32_t window_error_exit;
+// Reporter thread state, started on the first traced error so processes without X errors never create it
+#define WINDOW_ERROR_THREAD_IDLE 0
+#define WINDOW_ERROR_THREAD_STARTING 1
+#define WINDOW_ERROR_THREAD_RUNNING 2
+static atomic32_t window_error_state;
+static thread_t window_error_thread;
+static char window_error_stacktrace[8 * 1024];
+
+static bool
+window_error_trace_allowed(void) {
+	tick_t now = time_current();
+	tick_t last = atomic_load64(&window_error_last_trace, memory_order_relaxed);
+	if (last && ((now - last) < window_error_interval))
+		return false;
+	return atomic_cas64(&window_error_last_trace, now, last, memory_order_relaxed, memory_order_relaxed);
+}
+
+static void*
+window_error_thread_entry(void* arg);
+
+static void
+window_error_start(void) {
+	if (!atomic_cas32(&window_error_state, WINDOW_ERROR_THREAD_STARTING, WINDOW_ERROR_THREAD_IDLE,
+	                  memory_order_acquire, memory_order_relaxed)) {
+		// A starting thread reports the records when it wakes up
+		if (atomic_load32(&window_error_state, memory_order_acquire) == WINDOW_ERROR_THREAD_RUNNING)
+			semaphore_post(&window_error_signal);
+		return;
+	}
+	semaphore_initialize(&window_error_signal, 0);
+	thread_initialize(&window_error_thread, window_error_thread_entry, 0, STRING_CONST("window_error"),
+	                  THREAD_PRIORITY_LOW, 0);
+	thread_start(&window_error_thread);
+	atomic_store32(&window_error_state, WINDOW_ERROR_THREAD_RUNNING, memory_order_release);
+	semaphore_post(&window_error_signal);
+}
+
 static int
 x11_error_handler(Display* display, XErrorEvent* event) {
-	char errmsg[512];
-	XGetErrorText(display, event->error_code, errmsg, sizeof(errmsg));
-	log_warnf(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("X error event occurred: %s"), errmsg);
-
-	void* frame[64];
-	size_t frame_count = stacktrace_capture(frame, sizeof(frame) / sizeof(frame[0]), 0);
-	if (frame_count) {
-		size_t capacity = 8 * 1024;
-		char* buffer = memory_allocate(HASH_WINDOW, capacity, 0, MEMORY_PERSISTENT);
-		string_t stacktrace = stacktrace_resolve(buffer, capacity, frame, frame_count, 0);
-		log_infof(HASH_WINDOW, STRING_CONST("Stack trace:\n%.*s"), STRING_FORMAT(stacktrace));
-		memory_deallocate(buffer);
+	atomic_add64(&window_error_total, 1, memory_order_relaxed);
+	atomic_add64(&window_error_code[event->error_code], 1, memory_order_relaxed);
+	atomic_add64(&window_error_request[event->request_code], 1, memory_order_relaxed);
+	// Code, request and minor opcodes packed for window_error_stats
+	atomic_store64(&window_error_last,
+	               (int64_t)(((uint64_t)event->resourceid << 24) | ((uint64_t)event->minor_code << 16) |
+	                         ((uint64_t)event->request_code << 8) | (uint64_t)event->error_code),
+	               memory_order_relaxed);
+
+	if (!window_error_trace_allowed()) {
+		atomic_add64(&window_error_suppressed, 1, memory_order_relaxed);
+		return 0;
+	}
+
+	// Claim a slot, same sequence scheme as the window event ring
+	window_error_record_t* record;
+	int32_t position = atomic_load32(&window_error_write, memory_order_relaxed);
+	while (true) {
+		record = window_error_ring + ((uint32_t)position & (WINDOW_ERROR_RING_SIZE - 1));
+		int32_t diff = (int32_t)((uint32_t)atomic_load32(&record->sequence, memory_order_acquire) - (uint32_t)position);
+		if (diff == 0) {
+			if (atomic_cas32(&window_error_write, (int32_t)((uint32_t)position + 1), position, memory_order_relaxed,
+			                 memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			atomic_add64(&window_error_dropped, 1, memory_order_relaxed);
+			return 0;
+		}
+		position = atomic_load32(&window_error_write, memory_order_relaxed);
+	}
+
+	record->error_code = event->error_code;
+	record->request_code = event->request_code;
+	record->minor_code = event->minor_code;
+	record->display = display;
+	record->resource = event->resourceid;
+	record->serial = event->serial;
+	record->frame_count = stacktrace_capture(record->frame, WINDOW_ERROR_FRAMES, 1);
+	atomic_store32(&record->sequence, (int32_t)((uint32_t)position + 1), memory_order_release);
+	window_error_start();
+	return 0;
+}
+
+static void
+window_error_report(void) {
+	while (true) {
+		window_error_record_t* record = window_error_ring + ((uint32_t)window_error_read & (WINDOW_ERROR_RING_SIZE - 1));
+		if (atomic_load32(&record->sequence, memory_order_acquire) != (int32_t)((uint32_t)window_error_read + 1))
+			break;
+
+		char errmsg[256];
+		errmsg[0] = 0;
+		XGetErrorText(record->display, (int)record->error_code, errmsg, sizeof(errmsg));
+		unsigned long long suppressed =
+		    (unsigned long long)atomic_load64(&window_error_suppressed, memory_order_relaxed);
+		log_warnf(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL,
+		          STRING_CONST("X error event occurred: %s (request %u.%u, resource 0x%lx, serial %lu, %llu errors "
+		                       "not traced)"),
+		          errmsg, record->request_code, record->minor_code, record->resource, record->serial, suppressed);
+		if (record->frame_count) {
+			string_t stacktrace = stacktrace_resolve(window_error_stacktrace, sizeof(window_error_stacktrace),
+			                                         record->frame, record->frame_count, 0);
+			log_infof(HASH_WINDOW, STRING_CONST("Stack trace:\n%.*s"), STRING_FORMAT(stacktrace));
+		}
+		atomic_add64(&window_error_traced, 1, memory_order_relaxed);
+
+		atomic_store32(&record->sequence, (int32_t)((uint32_t)window_error_read + WINDOW_ERROR_RING_SIZE),
+		               memory_order_release);
+		window_error_read = (int32_t)((uint32_t)window_error_read + 1);
+	}
+}
+
+static void*
+window_error_thread_entry(void* arg) {
+	FOUNDATION_UNUSED(arg);
+	while (!atomic_load32(&window_error_exit, memory_order_acquire)) {
+		semaphore_wait(&window_error_signal);
+		window_error_report();
 	}
 	return 0;
 }
 
+static void
+window_error_initialize(const window_config_t* config) {
+	unsigned int interval = config->error_trace_interval ? config->error_trace_interval : 1000;
+	window_error_interval = (time_ticks_per_second() * (tick_t)interval) / 1000;
+	for (int32_t islot = 0; islot < WINDOW_ERROR_RING_SIZE; ++islot)
+		atomic_store32(&window_error_ring[islot].sequence, islot, memory_order_relaxed);
+	atomic_store32(&window_error_write, 0, memory_order_relaxed);
+	window_error_read = 0;
+	window_error_stats_reset();
+	atomic_store32(&window_error_exit, 0, memory_order_relaxed);
+	atomic_store32(&window_error_state, WINDOW_ERROR_THREAD_IDLE, memory_order_relaxed);
+}
+
+static void
+window_error_finalize(void) {
+	if (atomic_load32(&window_error_state, memory_order_acquire) == WINDOW_ERROR_THREAD_RUNNING) {
+		atomic_store32(&window_error_exit, 1, memory_order_release);
+		semaphore_post(&window_error_signal);
+		thread_join(&window_error_thread);
+		thread_finalize(&window_error_thread);
+		semaphore_finalize(&window_error_signal);
+	}
+	atomic_store32(&window_error_state, WINDOW_ERROR_THREAD_IDLE, memory_order_relaxed);
+	// Report what the thread did not get to while the displays are still open
+	window_error_report();
+}
+
+#endif
+
+void
+window_error_stats(window_error_stats_t* stats) {
+	memset(stats, 0, sizeof(window_error_stats_t));
+#if FOUNDATION_PLATFORM_LINUX
+	stats->total = (uint64_t)atomic_load64(&window_error_total, memory_order_relaxed);
+	for (size_t icode = 0; icode < WINDOW_ERROR_CODES; ++icode) {
+		stats->code[icode] = (uint64_t)atomic_load64(&window_error_code[icode], memory_order_relaxed);
+		stats->request[icode] = (uint64_t)atomic_load64(&window_error_request[icode], memory_order_relaxed);
+	}
+	stats->traced = (uint64_t)atomic_load64(&window_error_traced, memory_order_relaxed);
+	stats->suppressed = (uint64_t)atomic_load64(&window_error_suppressed, memory_order_relaxed);
+	stats->dropped = (uint64_t)atomic_load64(&window_error_dropped, memory_order_relaxed);
+	uint64_t last = (uint64_t)atomic_load64(&window_error_last, memory_order_relaxed);
+	stats->last_code = (unsigned int)(last & 0xFF);
+	stats->last_request = (unsigned int)((last >> 8) & 0xFF);
+	stats->last_minor = (unsigned int)((last >> 16) & 0xFF);
+	stats->last_resource = (unsigned long)(last >> 24);
 #endif
+}
+
+void
+window_error_stats_reset(void) {
+#if FOUNDATION_PLATFORM_LINUX
+	atomic_store64(&window_error_total, 0, memory_order_relaxed);
+	for (size_t icode = 0; icode < WINDOW_ERROR_CODES; ++icode) {
+		atomic_store64(&window_error_code[icode], 0, memory_order_relaxed);
+		atomic_store64(&window_error_request[icode], 0, memory_order_relaxed);
+	}
+	atomic_store64(&window_error_traced, 0, memory_order_relaxed);
+	atomic_store64(&window_error_suppressed, 0, memory_order_relaxed);
+	atomic_store64(&window_error_dropped, 0, memory_order_relaxed);
+	atomic_store64(&window_error_last, 0, memory_order_relaxed);
+	atomic_store64(&window_error_last_trace, 0, memory_order_relaxed);
+#endif
+}
 
 int
 window_module_initialize(const window_config_t config) {
-	FOUNDATION_UNUSED(config);
 	if (window_initialized)
 		return 0;
 
-	if (window_event_initialize() < 0)
+	if (window_handle_initialize() < 0)
+		return -1;
+
+	if (window_pool_initialize(&config) < 0)
 		return -1;
 
+	if (window_event_initialize(&config) < 0)
+		return -1;
+
+	// Narrowing the selected input is opt-in, native input consumers get all core input by default
+	window_input_default = WINDOW_INPUT_ALL;
+	if (config.input_default)
+		window_input_default = config.input_default & (WINDOW_INPUT_ALL | WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+
 #if FOUNDATION_PLATFORM_MACOS || FOUNDATION_PLATFORM_IOS
 	window_class_reference();
 #endif
 
 #if FOUNDATION_PLATFORM_LINUX
 	XInitThreads();
+	window_error_initialize(&config);
 	XSetErrorHandler(x11_error_handler);
 #endif
 
 #if FOUNDATION_PLATFORM_APPLE || FOUNDATION_PLATFORM_LINUX
-	window_native_initialize();
+	window_native_initialize(&config);
+#endif
+
+#if WINDOW_ENABLE_STATISTICS
+	window_stats_reset();
 #endif
 
 	window_initialized = true;
@@ -70,12 +605,19 @@ window_module_initialize(const window_config_t config) {
 
 void
 window_module_finalize(void) {
+#if FOUNDATION_PLATFORM_LINUX
+	window_error_finalize();
+#endif
+
 #if FOUNDATION_PLATFORM_APPLE || FOUNDATION_PLATFORM_LINUX
 	window_native_finalize();
 #endif
 
 	window_event_finalize();
 
+	window_pool_finalize();
+	window_handle_finalize();
+
 	window_initialized = false;
 }
 
@@ -83,3 +625,19 @@ bool
 window_module_is_initialized(void) {
 	return window_initialized;
 }
+
+void
+window_input_enable(window_t* window, unsigned int input) {
+	window->input |= (input & (WINDOW_INPUT_ALL | WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW));
+#if FOUNDATION_PLATFORM_LINUX
+	window_native_input_update(window);
+#endif
+}
+
+void
+window_input_disable(window_t* window, unsigned int input) {
+	window->input &= ~input;
+#if FOUNDATION_PLATFORM_LINUX
+	window_native_input_update(window);
+#endif
+}
@@ -31,6 +31,38 @@ window_module_is_initialized(void);
 WINDOW_API version_t
 window_module_version(void);
 
+//! Get instrumentation counters. All zero unless built with WINDOW_ENABLE_STATISTICS
+//  \param stats Statistics structure to fill
+WINDOW_API void
+window_stats_get(window_stats_t* stats);
+
+//! Reset instrumentation counters
+WINDOW_API void
+window_stats_reset(void);
+
+//! Get windowing system error counters. Errors are counted in the error handler, while error text
+//  and stack traces are resolved and logged asynchronously at a limited rate. All zero on platforms
+//  other than X11
+//  \param stats Statistics structure to fill
+WINDOW_API void
+window_error_stats(window_error_stats_t* stats);
+
+//! Reset windowing system error counters and the trace rate limit
+WINDOW_API void
+window_error_stats_reset(void);
+
+//! Get the generation checked handle of a window
+//  \param window Window
+//  \return Handle, WINDOW_HANDLE_INVALID if window is not created
+WINDOW_API window_handle_t
+window_handle(window_t* window);
+
+//! Resolve a window handle without locking
+//  \param handle Window handle
+//  \return Window, null if the handle is stale (window was finalized) or invalid
+WINDOW_API window_t*
+window_handle_resolve(window_handle_t handle);
+
 //! Main window message loop. Blocks until application termination
 //  \return 0 if success, <0 if error
 WINDOW_API int
@@ -91,6 +123,8 @@ window_set_cursor_pos(window_t* window, int x, int y);
 WINDOW_API bool
 window_is_cursor_locked(window_t* window);
 
+//! Set the UTF-8 window title. Safe to call from any thread. On X11 the update is queued and written by
+//  the message loop, only the latest title per window is written each loop iteration
 WINDOW_API void
 window_set_title(window_t* window, const char* title, size_t length);
 
@@ -109,6 +143,20 @@ window_position_y(window_t* window);
 WINDOW_API void
 window_fit_to_screen(window_t* window);
 
+//! Enable native input events for the window. Input is also enabled while event callbacks or
+//  subscriptions need it, the windowing system is only asked for the union. Creating the window
+//  resets enabled input to window_config_t::input_default
+//  \param window Window
+//  \param input Input categories, combination of WINDOW_INPUT_* flags
+WINDOW_API void
+window_input_enable(window_t* window, unsigned int input);
+
+//! Disable native input events for the window previously enabled with window_input_enable
+//  \param window Window
+//  \param input Input categories, combination of WINDOW_INPUT_* flags
+WINDOW_API void
+window_input_disable(window_t* window, unsigned int input);
+
 WINDOW_API int
 window_screen_width(unsigned int adapter);
 
@@ -159,12 +207,121 @@ WINDOW_API void
 window_create(window_t* window, unsigned int adapter, const char* title, size_t length, unsigned int width,
               unsigned int height, unsigned int flags);
 
+//! Create a window without waiting for the server. Returns once the requests are queued, the
+//  WINDOWEVENT_CREATE event is posted when the window is mapped (immediately with WINDOW_FLAG_NOSHOW).
+//  Input context setup is deferred to the map, native handles are valid on return
+//  \param window Window to create
+//  \param adapter Screen, WINDOW_ADAPTER_DEFAULT for default screen
+//  \param title Window title
+//  \param length Length of title
+//  \param width Width in pixels
+//  \param height Height in pixels
+//  \param flags Window flags
+WINDOW_API void
+window_create_async(window_t* window, unsigned int adapter, const char* title, size_t length, unsigned int width,
+                    unsigned int height, unsigned int flags);
+
+//! Allocate and create many windows at once. The visual and colormap are chosen once per screen and
+//  shared, all create and map requests are issued in one burst followed by a single sync. The
+//  WINDOWEVENT_CREATE event is posted for each window. Input context setup is deferred to the map as for
+//  window_create_async. Deallocate windows with window_deallocate
+//  \param infos Window parameters
+//  \param count Number of windows
+//  \param out Array receiving count windows, null for windows that could not be created
+//  \return Number of windows created
+WINDOW_API size_t
+window_create_batch(const window_create_info_t* infos, size_t count, window_t** out);
+
+//! Allocate and create a lightweight child window inside an existing window. The child shares the
+//  visual and colormap of the parent and gets no window manager properties or input context. Events
+//  are routed through the same message loop. Children still open are finalized with the parent
+//  \param parent Parent window
+//  \param x Horizontal position in parent
+//  \param y Vertical position in parent
+//  \param width Width in pixels
+//  \param height Height in pixels
+//  \param flags Window flags, only WINDOW_FLAG_NOSHOW applies
+//  \return Child window, null if parent is not open. Deallocate with window_deallocate
+WINDOW_API window_t*
+window_create_child(window_t* parent, int x, int y, unsigned int width, unsigned int height, unsigned int flags);
+
+//! Keep the full pointer motion history of the window, for consumers such as drawing tools that
+//  need every sample rather than the compressed WINDOWEVENT_POINTERMOVE events. Samples that do not
+//  fit are dropped until read with window_pointer_history
+//  \param window Window
+//  \param capacity Number of samples to buffer, zero to disable and free the buffer
+WINDOW_API void
+window_pointer_history_enable(window_t* window, size_t capacity);
+
+//! Read and remove buffered pointer motion samples, oldest first. Single consumer only, safe to call
+//  concurrently with window_pointer_history_enable from another thread
+//  \param window Window
+//  \param samples Destination array
+//  \param capacity Capacity of destination array
+//  \return Number of samples read
+WINDOW_API size_t
+window_pointer_history(window_t* window, window_pointer_sample_t* samples, size_t capacity);
+
+//! Copy the current input state of the window, for game loops polling input each tick instead of
+//  consuming events. The message loop publishes the state once per wake-up, reading does not lock
+//  and only retries if the loop publishes during the copy
+//  \param window Window
+//  \param state Destination state
+WINDOW_API void
+window_input_snapshot(window_t* window, window_input_state_t* state);
+
+//! Get the key code of a key symbol, for testing window_input_state_t::keys
+//  \param window Window
+//  \param symbol Key symbol (X keysym)
+//  \return Key code, zero if no key produces the symbol
+WINDOW_API unsigned int
+window_key_code(window_t* window, uint32_t symbol);
+
+//! Copy the monitors of the default screen. Monitors are queried once and refreshed when the
+//  windowing system reports a change, see WINDOWEVENT_MONITORS_CHANGED. Reading does not query the
+//  windowing system, cheap enough to call every frame. On Wayland these are the compositor outputs
+//  \param monitors Destination array, can be null if capacity is zero
+//  \param capacity Capacity of destination array
+//  \return Number of monitors, can be larger than capacity
+WINDOW_API size_t
+window_monitors(window_monitor_t* monitors, size_t capacity);
+
+//! Enter or leave fullscreen without recreating the window. Fullscreen windows ask compositing window
+//  managers to unredirect them, removing the compositor copy of each frame. Requests are queued without
+//  waiting for the window manager, the resize is reported through WINDOWEVENT_RESIZE. On an unmapped
+//  window the state property is updated in place, which is one round trip
+//  \param window Window
+//  \param fullscreen Fullscreen state
+//  \param monitor Index into the array returned by window_monitors, WINDOW_MONITOR_CURRENT for the monitor
+//                 containing the window
+WINDOW_API void
+window_set_fullscreen(window_t* window, bool fullscreen, unsigned int monitor);
+
+//! Query the requested fullscreen state of the window
+//  \param window Window
+//  \return true if fullscreen was requested, either by WINDOW_FLAG_FULLSCREEN or window_set_fullscreen
+WINDOW_API bool
+window_is_fullscreen(window_t* window);
+
+//! Signal that a frame for the current window size has been drawn. For windows created with
+//  WINDOW_FLAG_SYNCRESIZE the window manager waits for this before sending the next size during
+//  interactive resize, instead of queueing sizes faster than they can be drawn. Call after presenting
+//  the frame drawn in response to WINDOWEVENT_RESIZE, a no-op if no resize is waiting
+//  \param window Window
+WINDOW_API void
+window_frame_complete(window_t* window);
+
 WINDOW_API void*
 window_display(window_t* window);
 
 WINDOW_API int
 window_screen(window_t* window);
 
+//! Get the native drawable, the X11 window or the wl_surface on Wayland. Querying the wl_surface hands
+//  the surface over to the caller, for example to create an EGL window on it, and the library stops
+//  attaching its own placeholder buffer
+//  \param window Window
+//  \return Native drawable
 WINDOW_API unsigned long
 window_drawable(window_t* window);
 
@@ -21,17 +21,19 @@
 
 window_t*
 window_allocate(void* native) {
-	window_t* window = memory_allocate(0, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	window_t* window = window_pool_allocate();
 	window_initialize(window, native);
 	return window;
 }
 
 void
 window_initialize(window_t* window, void* native) {
+	window_handle_acquire(window);
 }
 
 void
 window_finalize(window_t* window) {
+	window_handle_release(window);
 }
 
 void*
@@ -55,7 +57,7 @@ window_hide_keyboard(window_t* window) {
 void
 window_deallocate(window_t* window) {
 	window_finalize(window);
-	memory_deallocate(window);
+	window_pool_deallocate(window);
 }
 
 unsigned int
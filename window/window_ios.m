@@ -38,9 +38,9 @@ _window_native_finalize(void) {
 
 window_t*
 window_allocate_from_uiwindow(void* uiwindow) {
-	window_t* window =
-	    memory_allocate(0, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	window_t* window = window_pool_allocate();
 	window->uiwindow = uiwindow;
+	window_handle_acquire(window);
 	return window;
 }
 
@@ -140,7 +140,8 @@ window_hide_keyboard(window_t* window) {
 
 void
 window_deallocate(window_t* window) {
-	memory_deallocate(window);
+	window_handle_release(window);
+	window_pool_deallocate(window);
 }
 
 unsigned int
@@ -19,44 +19,192 @@
 #include <foundation/foundation.h>
 
 #include <GL/glx.h>
+#include <X11/XKBlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#if WINDOW_ENABLE_XINPUT2
+#include <X11/extensions/XInput2.h>
+#endif
+#if WINDOW_ENABLE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+#include <X11/extensions/sync.h>
 
 #define _NET_WM_STATE_REMOVE 0
 #define _NET_WM_STATE_ADD 1
 //#define _NET_WM_STATE_TOGGLE 2
 
 static Display* window_default_display;
+static XIM window_default_xim;
+static XContext window_context;
+static Atom window_atom_delete;
+static Atom window_atom_protocols;
+static Atom window_atom_wm_state;
+static Atom window_atom_fullscreen;
+static Atom window_atom_fullscreen_monitors;
+static Atom window_atom_bypass_compositor;
+static Atom window_atom_sync_request;
+static Atom window_atom_sync_request_counter;
+static Atom window_atom_net_wm_name;
+static Atom window_atom_utf8_string;
+static Atom window_atom_maximized_horz;
+static Atom window_atom_maximized_vert;
+static Atom window_atom_hidden;
+static Atom window_atom_change_state;
+// XSync extension available for _NET_WM_SYNC_REQUEST resize synchronization
+static bool window_sync_available;
+// Invisible cursor defined on windows hiding the cursor, created on first use
+static Cursor window_blank_cursor;
+
+// Visual and colormap shared by windows created in batches, per screen
+#define WINDOW_SHARED_SCREENS 16
+static XVisualInfo* window_shared_visual[WINDOW_SHARED_SCREENS];
+static Colormap window_shared_colormap[WINDOW_SHARED_SCREENS];
 
 static window_t** window_list;
 static mutex_t* window_mutex;
 
+// Title updates are queued by window_set_title and written by the message loop, which is woken through
+// the eventfd when the first update since the last write is queued
+static mutex_t* window_title_mutex;
+#define WINDOW_TITLE_CAPACITY 256
+static atomic32_t window_title_pending;
+static int window_wake_fd = -1;
+
+#if WINDOW_ENABLE_WAYLAND
+static bool window_use_wayland;
+#endif
+
+// Published monitor cache generation, zero until the display is opened
+static atomic32_t window_monitor_sequence;
+
+#if WINDOW_ENABLE_XINPUT2
+static bool window_xinput_available;
+static int window_xinput_opcode;
+static bool window_xinput_raw_selected;
+#endif
+
 static void
-window_add(window_t* window) {
+window_lock_display(Display* display) {
+#if WINDOW_ENABLE_STATISTICS
+	tick_t start = time_current();
+	XLockDisplay(display);
+	window_stats_record_lock_acquired(WINDOW_STATS_LOCK_DISPLAY, start);
+#else
+	XLockDisplay(display);
+#endif
+}
+
+static void
+window_unlock_display(Display* display) {
+#if WINDOW_ENABLE_STATISTICS
+	window_stats_record_lock_released(WINDOW_STATS_LOCK_DISPLAY);
+#endif
+	XUnlockDisplay(display);
+}
+
+static void
+window_lock_list(void) {
+#if WINDOW_ENABLE_STATISTICS
+	tick_t start = time_current();
 	mutex_lock(window_mutex);
-	array_push(window_list, window);
+	window_stats_record_lock_acquired(WINDOW_STATS_LOCK_WINDOW_LIST, start);
+#else
+	mutex_lock(window_mutex);
+#endif
+}
+
+static void
+window_unlock_list(void) {
+#if WINDOW_ENABLE_STATISTICS
+	window_stats_record_lock_released(WINDOW_STATS_LOCK_WINDOW_LIST);
+#endif
 	mutex_unlock(window_mutex);
 }
 
+static void
+window_add(window_t* window) {
+	window_lock_list();
+	array_push(window_list, window);
+	window_unlock_list();
+}
+
 static void
 window_remove(window_t* window) {
-	mutex_lock(window_mutex);
+	window_lock_list();
 	for (size_t iwin = 0, wsize = array_size(window_list); iwin < wsize; ++iwin) {
 		if (window_list[iwin] == window) {
 			array_erase(window_list, iwin);
 			break;
 		}
 	}
-	mutex_unlock(window_mutex);
+	window_unlock_list();
 }
 
 void
-window_native_initialize(void) {
+window_native_initialize(const window_config_t* config) {
+	size_t capacity = config->window_capacity ? config->window_capacity : 16;
 	window_mutex = mutex_allocate(STRING_CONST("window_list"));
+	window_title_mutex = mutex_allocate(STRING_CONST("window_title"));
+	atomic_store32(&window_title_pending, 0, memory_order_relaxed);
+	window_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (window_wake_fd < 0)
+		log_warn(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL,
+		         STRING_CONST("Unable to create message loop wake descriptor, titles update with the next event"));
 	window_list = 0;
+	array_reserve(window_list, capacity);
+	window_context = XUniqueContext();
+#if WINDOW_ENABLE_WAYLAND
+	window_use_wayland = window_wayland_initialize(capacity);
+#endif
 }
 
 void
 window_native_finalize(void) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland)
+		window_wayland_finalize();
+	window_use_wayland = false;
+#endif
+	if (window_default_xim)
+		XCloseIM(window_default_xim);
+	window_default_xim = 0;
+	for (int iscreen = 0; iscreen < WINDOW_SHARED_SCREENS; ++iscreen) {
+		if (window_shared_colormap[iscreen])
+			XFreeColormap(window_default_display, window_shared_colormap[iscreen]);
+		if (window_shared_visual[iscreen])
+			XFree(window_shared_visual[iscreen]);
+		window_shared_colormap[iscreen] = 0;
+		window_shared_visual[iscreen] = 0;
+	}
+	window_atom_delete = 0;
+	window_atom_protocols = 0;
+	window_atom_wm_state = 0;
+	window_atom_fullscreen = 0;
+	window_atom_fullscreen_monitors = 0;
+	window_atom_bypass_compositor = 0;
+	window_atom_sync_request = 0;
+	window_atom_sync_request_counter = 0;
+	window_atom_net_wm_name = 0;
+	window_atom_utf8_string = 0;
+	window_sync_available = false;
+	if (window_blank_cursor)
+		XFreeCursor(window_default_display, window_blank_cursor);
+	window_blank_cursor = 0;
+	atomic_store32(&window_monitor_sequence, 0, memory_order_release);
+#if WINDOW_ENABLE_XINPUT2
+	window_xinput_available = false;
+	window_xinput_raw_selected = false;
+#endif
+	if (window_default_display)
+		XCloseDisplay(window_default_display);
+	window_default_display = 0;
 	mutex_deallocate(window_mutex);
+	mutex_deallocate(window_title_mutex);
+	window_title_mutex = 0;
+	if (window_wake_fd >= 0)
+		close(window_wake_fd);
+	window_wake_fd = -1;
 	array_deallocate(window_list);
 }
 
@@ -86,111 +234,1421 @@ window_get_xvisual(Display* display, int screen, unsigned int color, unsigned in
 
 	return glXChooseVisual(display, screen, config);
 #endif
-}
+}
+
+window_t*
+window_allocate(void) {
+	return window_pool_allocate();
+}
+
+// Input context creation talks to the input method server, for asynchronously and batch created windows
+// it is deferred to the message loop when the window is mapped. Called with the display locked
+static void
+window_create_input_context(window_t* window, window_stats_call call) {
+	FOUNDATION_UNUSED(call);
+	// Input method is shared by all windows and closed in window_native_finalize
+	if (!window_default_xim) {
+		window_default_xim = XOpenIM(window->display, 0, 0, 0);
+		WINDOW_STATS_ROUNDTRIP(call, 1);
+	}
+	XIM xim = window_default_xim;
+	XIC xic = 0;
+	if (xim) {
+		xic = XCreateIC(xim, XNInputStyle, XIMPreeditNone | XIMStatusNone, XNClientWindow, window->drawable, nullptr);
+		WINDOW_STATS_ROUNDTRIP(call, 1);
+		if (xic) {
+			/*XGetICValues(ic, XNFilterEvents, &fevent, NULL);
+			mask = ExposureMask | KeyPressMask | FocusChangeMask;
+			XSelectInput(display, window, mask|fevent);*/
+		} else {
+			log_warn(HASH_WINDOW, WARNING_SUSPICIOUS, STRING_CONST("Unable to create X input context"));
+		}
+	} else {
+		log_warn(HASH_WINDOW, WARNING_SUSPICIOUS, STRING_CONST("Unable to open X input method"));
+	}
+	window->xim = xim;
+	window->xic = xic;
+}
+
+// Keysyms for all keycodes at shift levels 0 and 1 of the first group, rebuilt from XkbGetMap when
+// the mapping changes. Only accessed with the display locked
+static KeySym window_keymap[256][2];
+static bool window_keymap_valid;
+static bool window_keymap_xkb;
+static int window_keymap_event_base;
+// Keys currently held, to flag repeats when detectable autorepeat suppresses the synthetic releases
+static uint8_t window_key_held[32];
+
+// Windows with input state changes not yet published, only accessed with the display locked
+static bool window_input_pending;
+
+static void
+window_input_changed(window_t* window) {
+	window->input_dirty = true;
+	window_input_pending = true;
+}
+
+// Double buffered seqlock, the live state is copied to the buffer readers are not directed to before
+// the sequence flips to it. Called with the display locked
+static void
+window_input_publish(window_t* window) {
+	int32_t sequence = atomic_load32(&window->input_sequence, memory_order_relaxed) + 1;
+	window_input_state_t* state = window->input_published + (sequence & 1);
+	window->input_live.sequence = (uint32_t)sequence;
+	*state = window->input_live;
+	atomic_store32(&window->input_sequence, sequence, memory_order_release);
+	window->input_dirty = false;
+}
+
+static void
+window_input_pointer(window_t* window, const window_pointer_event_t* pointer) {
+	window->input_live.x = pointer->x;
+	window->input_live.y = pointer->y;
+	window->input_live.modifiers = pointer->modifiers;
+	window_input_changed(window);
+}
+
+static void
+window_input_publish_pending(void) {
+	if (!window_input_pending)
+		return;
+	window_input_pending = false;
+	window_lock_list();
+	for (size_t iwin = 0, wsize = array_size(window_list); iwin < wsize; ++iwin) {
+		if (window_list[iwin]->input_dirty)
+			window_input_publish(window_list[iwin]);
+	}
+	window_unlock_list();
+}
+
+void
+window_input_snapshot(window_t* window, window_input_state_t* state) {
+	if (window->wayland || !window->created) {
+		memset(state, 0, sizeof(window_input_state_t));
+		return;
+	}
+	while (true) {
+		int32_t sequence = atomic_load32(&window->input_sequence, memory_order_acquire);
+		*state = window->input_published[sequence & 1];
+		atomic_thread_fence_acquire();
+		if (atomic_load32(&window->input_sequence, memory_order_relaxed) == sequence)
+			return;
+	}
+}
+
+unsigned int
+window_key_code(window_t* window, uint32_t symbol) {
+	if (window->wayland || !window->display)
+		return 0;
+	// Served from the keyboard mapping cached by Xlib, no round trip
+	window_lock_display(window->display);
+	unsigned int keycode = XKeysymToKeycode(window->display, (KeySym)symbol);
+	window_unlock_display(window->display);
+	return keycode;
+}
+
+// Pointer motion pending since the last flush. Consecutive motion in one loop wake-up is compressed into
+// a single event, only accessed with the display locked
+static window_t* window_motion_window;
+static XEvent window_motion_event;
+static window_pointer_event_t window_motion_pointer;
+static unsigned int window_motion_samples;
+#if WINDOW_ENABLE_XINPUT2
+// Pending motion came from XInput2, there is no native event to post
+static bool window_motion_xinput;
+static window_pointer_precise_event_t window_motion_precise;
+#endif
+
+// Single producer (message loop) single consumer ring of motion samples
+struct window_pointer_history_t {
+	uint32_t capacity;
+	atomic32_t read;
+	atomic32_t write;
+	atomic32_t dropped;
+	window_pointer_sample_t sample[FOUNDATION_FLEXIBLE_ARRAY];
+};
+
+static void
+window_keymap_initialize(Display* display) {
+	int opcode, error_base, major = XkbMajorVersion, minor = XkbMinorVersion;
+	window_keymap_xkb = XkbQueryExtension(display, &opcode, &window_keymap_event_base, &error_base, &major, &minor);
+	if (window_keymap_xkb) {
+		// Repeats arrive as consecutive presses instead of release and press pairs
+		Bool supported = False;
+		XkbSetDetectableAutoRepeat(display, True, &supported);
+		if (!supported)
+			log_warn(HASH_WINDOW, WARNING_UNSUPPORTED, STRING_CONST("Detectable autorepeat not supported"));
+		XkbSelectEvents(display, XkbUseCoreKbd, XkbNewKeyboardNotifyMask | XkbMapNotifyMask,
+		                XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+	}
+	window_keymap_valid = false;
+	memset(window_key_held, 0, sizeof(window_key_held));
+}
+
+static void
+window_keymap_build(Display* display) {
+	memset(window_keymap, 0, sizeof(window_keymap));
+	XkbDescPtr desc = window_keymap_xkb ? XkbGetMap(display, XkbKeySymsMask | XkbKeyTypesMask, XkbUseCoreKbd) : 0;
+	if (desc) {
+		for (int keycode = desc->min_key_code; keycode <= desc->max_key_code && keycode < 256; ++keycode) {
+			if (!XkbKeyNumGroups(desc, keycode))
+				continue;
+			int levels = XkbKeyGroupWidth(desc, keycode, XkbGroup1Index);
+			window_keymap[keycode][0] = XkbKeySymEntry(desc, keycode, 0, 0);
+			window_keymap[keycode][1] = (levels > 1) ? XkbKeySymEntry(desc, keycode, 1, 0) : window_keymap[keycode][0];
+		}
+		XkbFreeKeyboard(desc, 0, True);
+	} else {
+		int min_keycode = 0, max_keycode = 0, per_keycode = 0;
+		XDisplayKeycodes(display, &min_keycode, &max_keycode);
+		KeySym* syms = XGetKeyboardMapping(display, (KeyCode)min_keycode, max_keycode - min_keycode + 1, &per_keycode);
+		for (int keycode = min_keycode; syms && (keycode <= max_keycode) && (keycode < 256); ++keycode) {
+			KeySym* entry = syms + (keycode - min_keycode) * per_keycode;
+			window_keymap[keycode][0] = entry[0];
+			window_keymap[keycode][1] = ((per_keycode > 1) && entry[1]) ? entry[1] : entry[0];
+		}
+		if (syms)
+			XFree(syms);
+	}
+	window_keymap_valid = true;
+}
+
+static uint32_t
+window_key_modifiers(unsigned int state) {
+	uint32_t modifiers = 0;
+	if (state & ShiftMask)
+		modifiers |= WINDOW_MODIFIER_SHIFT;
+	if (state & ControlMask)
+		modifiers |= WINDOW_MODIFIER_CONTROL;
+	if (state & Mod1Mask)
+		modifiers |= WINDOW_MODIFIER_ALT;
+	if (state & Mod4Mask)
+		modifiers |= WINDOW_MODIFIER_SUPER;
+	if (state & LockMask)
+		modifiers |= WINDOW_MODIFIER_CAPSLOCK;
+	if (state & Mod2Mask)
+		modifiers |= WINDOW_MODIFIER_NUMLOCK;
+	return modifiers;
+}
+
+// Decode a key event through the cached keymap and post the typed events. Called with the display locked
+static void
+window_key_event(window_t* window, XKeyEvent* xkey) {
+	if (!window_keymap_valid)
+		window_keymap_build(xkey->display);
+
+	unsigned int keycode = xkey->keycode & 0xFF;
+	KeySym symbol = window_keymap[keycode][(xkey->state & ShiftMask) ? 1 : 0];
+	if (xkey->state & LockMask) {
+		KeySym lower, upper;
+		XConvertCase(symbol, &lower, &upper);
+		symbol = (xkey->state & ShiftMask) ? lower : upper;
+	}
+
+	window_key_event_t key;
+	key.symbol = (uint32_t)symbol;
+	key.keycode = keycode;
+	key.modifiers = window_key_modifiers(xkey->state);
+	uint8_t bit = (uint8_t)(1 << (keycode & 7));
+	if (xkey->type == KeyPress) {
+		key.repeat = (window_key_held[keycode >> 3] & bit) ? 1 : 0;
+		window_key_held[keycode >> 3] |= bit;
+		window->input_live.keys[keycode >> 3] |= bit;
+		window->input_live.modifiers = key.modifiers;
+		window_input_changed(window);
+		window_event_post_payload(WINDOWEVENT_KEYDOWN, window, &key, sizeof(key));
+	} else {
+		key.repeat = 0;
+		window_key_held[keycode >> 3] &= (uint8_t)~bit;
+		window->input_live.keys[keycode >> 3] &= (uint8_t)~bit;
+		window->input_live.modifiers = key.modifiers;
+		window_input_changed(window);
+		window_event_post_payload(WINDOWEVENT_KEYUP, window, &key, sizeof(key));
+		return;
+	}
+
+	if (!window->xic)
+		return;
+	char buffer[64];
+	KeySym lookup;
+	Status status = 0;
+	int length = Xutf8LookupString(window->xic, xkey, buffer, (int)sizeof(buffer), &lookup, &status);
+	if ((status != XLookupChars) && (status != XLookupBoth))
+		return;
+	// Control characters are delivered as key events only
+	if ((length <= 0) || ((length == 1) && (((unsigned char)buffer[0] < 0x20) || (buffer[0] == 0x7F))))
+		return;
+
+	window_text_event_t text;
+	int offset = 0;
+	while (offset < length) {
+		int chunk = length - offset;
+		if (chunk > WINDOW_TEXT_EVENT_LENGTH) {
+			// Split on a code point boundary
+			chunk = WINDOW_TEXT_EVENT_LENGTH;
+			while ((chunk > 1) && (((unsigned char)buffer[offset + chunk] & 0xC0) == 0x80))
+				--chunk;
+		}
+		text.length = (uint32_t)chunk;
+		memcpy(text.text, buffer + offset, (size_t)chunk);
+		window_event_post_payload(WINDOWEVENT_TEXT, window, &text, sizeof(text));
+		offset += chunk;
+	}
+}
+
+static void
+window_pointer_history_append(window_pointer_history_t* history, const window_pointer_event_t* pointer, Time time) {
+	int32_t write = atomic_load32(&history->write, memory_order_relaxed);
+	int32_t read = atomic_load32(&history->read, memory_order_acquire);
+	if ((uint32_t)(write - read) >= history->capacity) {
+		atomic_incr32(&history->dropped, memory_order_relaxed);
+		return;
+	}
+	window_pointer_sample_t* sample = history->sample + ((uint32_t)write % history->capacity);
+	sample->timestamp = time_current();
+	sample->time = (uint32_t)time;
+	sample->modifiers = pointer->modifiers;
+	sample->x = pointer->x;
+	sample->y = pointer->y;
+	atomic_store32(&history->write, write + 1, memory_order_release);
+}
+
+// Post the compressed pending motion, if any. Called with the display locked
+static void
+window_pointer_flush(void) {
+	window_t* window = window_motion_window;
+	if (!window)
+		return;
+	window_motion_window = 0;
+
+	uint16_t samples = (uint16_t)((window_motion_samples < 0xFFFF) ? window_motion_samples : 0xFFFF);
+	window_motion_samples = 0;
+	window_motion_pointer.samples = samples;
+#if WINDOW_ENABLE_XINPUT2
+	if (window_motion_xinput) {
+		window_event_post_payload(WINDOWEVENT_POINTERMOVE, window, &window_motion_pointer,
+		                          sizeof(window_motion_pointer));
+		window_motion_precise.samples = samples;
+		window_event_post_payload(WINDOWEVENT_POINTERPRECISE, window, &window_motion_precise,
+		                          sizeof(window_motion_precise));
+		return;
+	}
+#endif
+	window_event_post_native(WINDOWEVENT_NATIVE, window, &window_motion_event);
+	window_event_post_payload(WINDOWEVENT_POINTERMOVE, window, &window_motion_pointer, sizeof(window_motion_pointer));
+}
+
+// Queue motion for compression, flushing motion pending for another window first
+static void
+window_pointer_motion(window_t* window, XEvent* event) {
+#if WINDOW_ENABLE_XINPUT2
+	if (window_motion_xinput)
+		window_pointer_flush();
+	window_motion_xinput = false;
+#endif
+	if (window_motion_window != window)
+		window_pointer_flush();
+	window_motion_window = window;
+	window_motion_event = *event;
+	memset(&window_motion_pointer, 0, sizeof(window_motion_pointer));
+	window_motion_pointer.x = event->xmotion.x;
+	window_motion_pointer.y = event->xmotion.y;
+	window_motion_pointer.modifiers = window_key_modifiers(event->xmotion.state);
+	++window_motion_samples;
+	window_input_pointer(window, &window_motion_pointer);
+	if (window->pointer_history)
+		window_pointer_history_append(window->pointer_history, &window_motion_pointer, event->xmotion.time);
+}
+
+static void
+window_pointer_button(window_t* window, XButtonEvent* xbutton) {
+	window_pointer_event_t pointer;
+	memset(&pointer, 0, sizeof(pointer));
+	pointer.x = xbutton->x;
+	pointer.y = xbutton->y;
+	pointer.modifiers = window_key_modifiers(xbutton->state);
+	pointer.button = xbutton->button;
+	pointer.pressed = (xbutton->type == ButtonPress) ? 1 : 0;
+	window_input_pointer(window, &pointer);
+	if ((xbutton->button >= Button4) && (xbutton->button <= Button5 + 2)) {
+		// Core protocol reports wheel steps as press and release pairs of buttons 4-7, post the press only
+		if (xbutton->type != ButtonPress)
+			return;
+		if (xbutton->button == Button4)
+			pointer.wheel_y = 1;
+		else if (xbutton->button == Button5)
+			pointer.wheel_y = -1;
+		else if (xbutton->button == Button5 + 1)
+			pointer.wheel_x = -1;
+		else
+			pointer.wheel_x = 1;
+		// Smooth scrolling accumulates the same scroll with higher resolution
+		if (!(window->xi_input & WINDOW_INPUT_PRECISE)) {
+			window->input_live.wheel_x += pointer.wheel_x;
+			window->input_live.wheel_y += pointer.wheel_y;
+		}
+		window_event_post_payload(WINDOWEVENT_POINTERWHEEL, window, &pointer, sizeof(pointer));
+		return;
+	}
+	if ((xbutton->button >= 1) && (xbutton->button <= 32)) {
+		uint32_t bit = 1U << (xbutton->button - 1);
+		if (pointer.pressed)
+			window->input_live.buttons |= bit;
+		else
+			window->input_live.buttons &= ~bit;
+	}
+	window_event_post_payload(WINDOWEVENT_POINTERBUTTON, window, &pointer, sizeof(pointer));
+}
+
+void
+window_pointer_history_enable(window_t* window, size_t capacity) {
+	if (window->wayland)
+		return;
+	window_pointer_history_t* history = 0;
+	if (capacity) {
+		if (capacity > 0x10000000)
+			capacity = 0x10000000;
+		history = memory_allocate(HASH_WINDOW, sizeof(window_pointer_history_t) +
+		                                           (sizeof(window_pointer_sample_t) * capacity),
+		                          0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+		history->capacity = (uint32_t)capacity;
+	}
+	// The message loop appends and readers read with the display locked
+	if (window->display)
+		window_lock_display(window->display);
+	window_pointer_history_t* previous = window->pointer_history;
+	window->pointer_history = history;
+	if (window->display)
+		window_unlock_display(window->display);
+	if (previous)
+		memory_deallocate(previous);
+}
+
+size_t
+window_pointer_history(window_t* window, window_pointer_sample_t* samples, size_t capacity) {
+	if (window->wayland)
+		return 0;
+	// Hold the display lock so window_pointer_history_enable cannot free the buffer while reading
+	if (window->display)
+		window_lock_display(window->display);
+	window_pointer_history_t* history = window->pointer_history;
+	size_t count = 0;
+	if (history) {
+		int32_t read = atomic_load32(&history->read, memory_order_relaxed);
+		int32_t write = atomic_load32(&history->write, memory_order_acquire);
+		while ((read != write) && (count < capacity)) {
+			samples[count++] = history->sample[(uint32_t)read % history->capacity];
+			++read;
+		}
+		atomic_store32(&history->read, read, memory_order_release);
+	}
+	if (window->display)
+		window_unlock_display(window->display);
+	return count;
+}
+
+#if WINDOW_ENABLE_XINPUT2
+
+// XInput2 scroll valuators per source device, scroll events are the change in valuator value divided
+// by the increment of one wheel step. Only accessed with the display locked
+#define WINDOW_XINPUT_DEVICES 128
+
+typedef struct window_xinput_scroll_t {
+	int number[2];
+	double increment[2];
+	double value[2];
+	bool valid[2];
+} window_xinput_scroll_t;
+
+static window_xinput_scroll_t window_xinput_scroll[WINDOW_XINPUT_DEVICES];
+// Raw motion accumulated since the last flush
+static window_pointer_raw_event_t window_xinput_raw;
+static double window_xinput_raw_dx;
+static double window_xinput_raw_dy;
+
+static void
+window_xinput_query_scroll(Display* display, int deviceid) {
+	int count = 0;
+	XIDeviceInfo* info = XIQueryDevice(display, deviceid, &count);
+	for (int idev = 0; idev < count; ++idev) {
+		if ((info[idev].deviceid < 0) || (info[idev].deviceid >= WINDOW_XINPUT_DEVICES))
+			continue;
+		window_xinput_scroll_t* scroll = window_xinput_scroll + info[idev].deviceid;
+		memset(scroll, 0, sizeof(window_xinput_scroll_t));
+		scroll->number[0] = scroll->number[1] = -1;
+		for (int iclass = 0; iclass < info[idev].num_classes; ++iclass) {
+			if (info[idev].classes[iclass]->type != XIScrollClass)
+				continue;
+			XIScrollClassInfo* scroll_class = (XIScrollClassInfo*)info[idev].classes[iclass];
+			int axis = (scroll_class->scroll_type == XIScrollTypeVertical) ? 1 : 0;
+			scroll->number[axis] = scroll_class->number;
+			scroll->increment[axis] = (scroll_class->increment != 0.0) ? scroll_class->increment : 1.0;
+		}
+	}
+	if (info)
+		XIFreeDeviceInfo(info);
+}
+
+// Smooth scrolling needs XInput 2.1
+static void
+window_xinput_initialize(Display* display) {
+	int event_base, error_base;
+	int major = 2, minor = 1;
+	window_xinput_available =
+	    XQueryExtension(display, "XInputExtension", &window_xinput_opcode, &event_base, &error_base) &&
+	    (XIQueryVersion(display, &major, &minor) == Success) && ((major > 2) || ((major == 2) && (minor >= 1)));
+	if (!window_xinput_available) {
+		log_info(HASH_WINDOW, STRING_CONST("XInput 2.1 not available, precise and raw input disabled"));
+		return;
+	}
+	window_xinput_raw_selected = false;
+	window_xinput_query_scroll(display, XIAllDevices);
+}
+
+// XInput2 categories the window needs, a locked cursor reports relative motion as raw events
+static unsigned int
+window_xinput_wanted(window_t* window) {
+	unsigned int input = (window->input | window_event_input(window)) & (WINDOW_INPUT_PRECISE | WINDOW_INPUT_RAW);
+	if (window->cursor_lock)
+		input |= WINDOW_INPUT_RAW;
+	return input;
+}
+
+// Raw motion is only reported on root windows, select it while any window wants it. Called with the
+// display locked
+static void
+window_xinput_select_raw(Display* display, window_t* window) {
+	bool wanted = window && (window_xinput_wanted(window) & WINDOW_INPUT_RAW);
+	window_lock_list();
+	for (size_t iwin = 0, wsize = array_size(window_list); !wanted && (iwin < wsize); ++iwin)
+		wanted = (window_xinput_wanted(window_list[iwin]) & WINDOW_INPUT_RAW);
+	window_unlock_list();
+	if (wanted == window_xinput_raw_selected)
+		return;
+
+	unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+	memset(mask, 0, sizeof(mask));
+	if (wanted)
+		XISetMask(mask, XI_RawMotion);
+	XIEventMask event_mask = {XIAllMasterDevices, (int)sizeof(mask), mask};
+	for (int iscreen = 0, screens = ScreenCount(display); iscreen < screens; ++iscreen)
+		XISelectEvents(display, RootWindow(display, iscreen), &event_mask, 1);
+	window_xinput_raw_selected = wanted;
+}
+
+// Select XInput2 events for the window. Precise motion replaces core motion and crossing events, the
+// server delivers XInput2 events in preference to core events. Called with the display locked
+static void
+window_xinput_select(window_t* window) {
+	if (!window_xinput_available)
+		return;
+	unsigned int input = window_xinput_wanted(window);
+	if ((input & WINDOW_INPUT_PRECISE) != (window->xi_input & WINDOW_INPUT_PRECISE)) {
+		unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+		memset(mask, 0, sizeof(mask));
+		if (input & WINDOW_INPUT_PRECISE) {
+			XISetMask(mask, XI_Motion);
+			XISetMask(mask, XI_Enter);
+			XISetMask(mask, XI_DeviceChanged);
+		}
+		XIEventMask event_mask = {XIAllMasterDevices, (int)sizeof(mask), mask};
+		XISelectEvents(window->display, window->drawable, &event_mask, 1);
+	}
+	if ((input & WINDOW_INPUT_RAW) != (window->xi_input & WINDOW_INPUT_RAW))
+		window_xinput_select_raw(window->display, window);
+	if (input != window->xi_input)
+		XFlush(window->display);
+	window->xi_input = input;
+}
+
+static void
+window_xinput_motion(window_t* window, XIDeviceEvent* device) {
+	if (!window_motion_xinput)
+		window_pointer_flush();
+	window_motion_xinput = true;
+	if (window_motion_window != window)
+		window_pointer_flush();
+	window_motion_window = window;
+
+	memset(&window_motion_pointer, 0, sizeof(window_motion_pointer));
+	window_motion_pointer.x = (int32_t)math_floor(device->event_x);
+	window_motion_pointer.y = (int32_t)math_floor(device->event_y);
+	window_motion_pointer.modifiers = window_key_modifiers((unsigned int)device->mods.effective);
+	memset(&window_motion_precise, 0, sizeof(window_motion_precise));
+	window_motion_precise.x = (float)device->event_x;
+	window_motion_precise.y = (float)device->event_y;
+	window_motion_precise.time = (uint32_t)device->time;
+	window_motion_precise.device = (uint16_t)device->sourceid;
+	++window_motion_samples;
+	window_input_pointer(window, &window_motion_pointer);
+	if (window->pointer_history)
+		window_pointer_history_append(window->pointer_history, &window_motion_pointer, device->time);
+}
+
+// Returns true if the event changed a scroll valuator, the change in wheel steps is stored in scroll
+static bool
+window_xinput_scroll_delta(XIDeviceEvent* device, float* scroll) {
+	if ((device->sourceid < 0) || (device->sourceid >= WINDOW_XINPUT_DEVICES))
+		return false;
+	window_xinput_scroll_t* state = window_xinput_scroll + device->sourceid;
+	bool changed = false;
+	const double* value = device->valuators.values;
+	for (int ibit = 0; ibit < device->valuators.mask_len * 8; ++ibit) {
+		if (!XIMaskIsSet(device->valuators.mask, ibit))
+			continue;
+		for (int axis = 0; axis < 2; ++axis) {
+			if (state->number[axis] != ibit)
+				continue;
+			// First value after entering the window or a device change only sets the reference
+			if (state->valid[axis] && (*value != state->value[axis])) {
+				scroll[axis] = (float)((*value - state->value[axis]) / state->increment[axis]);
+				changed = true;
+			}
+			state->value[axis] = *value;
+			state->valid[axis] = true;
+		}
+		++value;
+	}
+	// Valuators increase scrolling down and right, wheel steps are positive up
+	scroll[1] = -scroll[1];
+	return changed;
+}
+
+static void
+window_xinput_device_motion(Display* display, XIDeviceEvent* device) {
+	window_t* window = 0;
+	if (XFindContext(display, device->event, window_context, (XPointer*)&window) || !window)
+		return;
+	// Scrolling is reported as motion of the scroll valuators
+	float scroll[2] = {0, 0};
+	if (!window_xinput_scroll_delta(device, scroll)) {
+		window_xinput_motion(window, device);
+		return;
+	}
+	window_pointer_flush();
+	window_pointer_precise_event_t precise;
+	memset(&precise, 0, sizeof(precise));
+	precise.x = (float)device->event_x;
+	precise.y = (float)device->event_y;
+	precise.scroll_x = scroll[0];
+	precise.scroll_y = scroll[1];
+	precise.time = (uint32_t)device->time;
+	precise.device = (uint16_t)device->sourceid;
+	window->input_live.wheel_x += scroll[0];
+	window->input_live.wheel_y += scroll[1];
+	window_input_changed(window);
+	window_event_post_payload(WINDOWEVENT_POINTERSCROLL, window, &precise, sizeof(precise));
+}
+
+static void
+window_xinput_raw_flush(void) {
+	if (!window_xinput_raw.samples)
+		return;
+	window_xinput_raw.dx = (float)window_xinput_raw_dx;
+	window_xinput_raw.dy = (float)window_xinput_raw_dy;
+
+	// Raw motion is not for a window, deliver to the window holding the pointer grab or else the focused
+	// window that wants it
+	window_t* target = 0;
+	window_lock_list();
+	for (size_t iwin = 0, wsize = array_size(window_list); iwin < wsize; ++iwin) {
+		window_t* window = window_list[iwin];
+		if (window->cursor_grabbed) {
+			target = window;
+			break;
+		}
+		if (!target && window->focus && (window->xi_input & WINDOW_INPUT_RAW))
+			target = window;
+	}
+	window_unlock_list();
+	if (target)
+		window_event_post_payload(WINDOWEVENT_POINTERRAW, target, &window_xinput_raw, sizeof(window_xinput_raw));
+
+	memset(&window_xinput_raw, 0, sizeof(window_xinput_raw));
+	window_xinput_raw_dx = 0;
+	window_xinput_raw_dy = 0;
+}
+
+static void
+window_xinput_raw_motion(XIRawEvent* raw) {
+	if (window_xinput_raw.samples && (window_xinput_raw.device != (uint16_t)raw->sourceid))
+		window_xinput_raw_flush();
+	// Raw values are packed for the set bits of the valuator mask, relative devices report x and y in
+	// valuators 0 and 1
+	const double* value = raw->raw_values;
+	for (int ibit = 0; (ibit < raw->valuators.mask_len * 8) && (ibit < 2); ++ibit) {
+		if (!XIMaskIsSet(raw->valuators.mask, ibit))
+			continue;
+		if (ibit == 0)
+			window_xinput_raw_dx += *value;
+		else
+			window_xinput_raw_dy += *value;
+		++value;
+	}
+	window_xinput_raw.time = (uint32_t)raw->time;
+	window_xinput_raw.device = (uint16_t)raw->sourceid;
+	if (window_xinput_raw.samples < 0xFFFF)
+		++window_xinput_raw.samples;
+}
+
+// XInput2 events are generic events without a window in the common header, returns true if the event
+// was consumed. Called with the display locked
+static bool
+window_xinput_event(XEvent* event) {
+	if (!window_xinput_available || (event->type != GenericEvent) ||
+	    (event->xcookie.extension != window_xinput_opcode))
+		return false;
+	Display* display = event->xcookie.display;
+	if (!XGetEventData(display, &event->xcookie))
+		return true;
+
+	XIEnterEvent* enter;
+	switch (event->xcookie.evtype) {
+		case XI_Motion:
+			window_xinput_device_motion(display, event->xcookie.data);
+			break;
+
+		case XI_Enter:
+			// Scroll valuators may have changed while the pointer was elsewhere
+			enter = event->xcookie.data;
+			if ((enter->sourceid >= 0) && (enter->sourceid < WINDOW_XINPUT_DEVICES))
+				memset(window_xinput_scroll[enter->sourceid].valid, 0, sizeof(window_xinput_scroll[0].valid));
+			break;
+
+		case XI_DeviceChanged:
+			window_xinput_query_scroll(display, ((XIDeviceChangedEvent*)event->xcookie.data)->sourceid);
+			break;
+
+		case XI_RawMotion:
+			window_xinput_raw_motion(event->xcookie.data);
+			break;
+
+		default:
+			break;
+	}
+
+	XFreeEventData(display, &event->xcookie);
+	return true;
+}
+
+#endif
+
+// Keyboard mapping notifications are not for a window, returns true if the event was consumed
+static bool
+window_keymap_event(XEvent* event) {
+	if (event->type == MappingNotify) {
+		if ((event->xmapping.request == MappingKeyboard) || (event->xmapping.request == MappingModifier)) {
+			XRefreshKeyboardMapping(&event->xmapping);
+			window_keymap_valid = false;
+		}
+		return true;
+	}
+	if (window_keymap_xkb && (event->type == window_keymap_event_base)) {
+		int xkb_type = ((XkbAnyEvent*)event)->xkb_type;
+		if ((xkb_type == XkbNewKeyboardNotify) || (xkb_type == XkbMapNotify))
+			window_keymap_valid = false;
+		return true;
+	}
+	return false;
+}
+
+// Monitor geometry is queried once and refreshed when the server reports a change. The cache is
+// published through a double buffered seqlock like the input state, readers never lock
+#define WINDOW_MONITOR_LIMIT 16
+
+typedef struct window_monitor_cache_t {
+	size_t count;
+	window_monitor_t monitor[WINDOW_MONITOR_LIMIT];
+	// Xinerama head index of each monitor, the monitor numbering of _NET_WM_FULLSCREEN_MONITORS
+	unsigned int head[WINDOW_MONITOR_LIMIT];
+} window_monitor_cache_t;
+
+static window_monitor_cache_t window_monitor_published[2];
+static bool window_monitor_dirty;
+#if WINDOW_ENABLE_XRANDR
+static bool window_monitor_xrandr;
+static bool window_monitor_xrandr_monitors;
+static int window_monitor_event_base;
+#endif
+
+#if WINDOW_ENABLE_XRANDR
+
+static float
+window_monitor_mode_rate(const XRRModeInfo* mode) {
+	double lines = (double)mode->vTotal;
+	if (mode->modeFlags & RR_DoubleScan)
+		lines *= 2.0;
+	if (mode->modeFlags & RR_Interlace)
+		lines /= 2.0;
+	if (!mode->hTotal || (lines <= 0.0))
+		return 0;
+	return (float)((double)mode->dotClock / ((double)mode->hTotal * lines));
+}
+
+// One monitor per active CRTC, clones share a CRTC. Called with the display locked
+static void
+window_monitor_query_xrandr(Display* display, window_monitor_cache_t* cache) {
+	Window root = DefaultRootWindow(display);
+	XRRScreenResources* resources = XRRGetScreenResourcesCurrent(display, root);
+	if (!resources)
+		return;
+	RROutput primary = XRRGetOutputPrimary(display, root);
+	for (int icrtc = 0; (icrtc < resources->ncrtc) && (cache->count < WINDOW_MONITOR_LIMIT); ++icrtc) {
+		XRRCrtcInfo* crtc = XRRGetCrtcInfo(display, resources, resources->crtcs[icrtc]);
+		if (!crtc)
+			continue;
+		if (crtc->mode && crtc->noutput) {
+			window_monitor_t* monitor = cache->monitor + cache->count++;
+			monitor->x = crtc->x;
+			monitor->y = crtc->y;
+			monitor->width = crtc->width;
+			monitor->height = crtc->height;
+			monitor->id = (uint32_t)crtc->outputs[0];
+			for (int ioutput = 0; ioutput < crtc->noutput; ++ioutput) {
+				if (crtc->outputs[ioutput] == primary)
+					monitor->primary = 1;
+			}
+			for (int imode = 0; imode < resources->nmode; ++imode) {
+				if (resources->modes[imode].id == crtc->mode)
+					monitor->refresh_rate = window_monitor_mode_rate(resources->modes + imode);
+			}
+			XRROutputInfo* output = XRRGetOutputInfo(display, resources, crtc->outputs[0]);
+			if (output) {
+				// Physical size is reported unrotated
+				bool rotated = (crtc->rotation & (RR_Rotate_90 | RR_Rotate_270));
+				monitor->width_mm = (uint32_t)(rotated ? output->mm_height : output->mm_width);
+				monitor->height_mm = (uint32_t)(rotated ? output->mm_width : output->mm_height);
+				string_copy(monitor->name, sizeof(monitor->name), output->name, (size_t)output->nameLen);
+				XRRFreeOutputInfo(output);
+			}
+		}
+		XRRFreeCrtcInfo(crtc);
+	}
+	XRRFreeScreenResources(resources);
+}
+
+// Xinerama emulated by RandR reports the same monitor list as XRRGetMonitors, match heads by geometry.
+// Returns false if the list is not available. Called with the display locked
+static bool
+window_monitor_query_heads(Display* display, window_monitor_cache_t* cache) {
+	if (!window_monitor_xrandr_monitors)
+		return false;
+	int count = 0;
+	XRRMonitorInfo* info = XRRGetMonitors(display, DefaultRootWindow(display), True, &count);
+	if (!info)
+		return false;
+	bool matched = true;
+	for (size_t imon = 0; imon < cache->count; ++imon) {
+		const window_monitor_t* monitor = cache->monitor + imon;
+		int ihead = 0;
+		while ((ihead < count) &&
+		       ((info[ihead].x != monitor->x) || (info[ihead].y != monitor->y) ||
+		        (info[ihead].width != (int)monitor->width) || (info[ihead].height != (int)monitor->height)))
+			++ihead;
+		matched = matched && (ihead < count);
+		cache->head[imon] = (unsigned int)ihead;
+	}
+	XRRFreeMonitors(info);
+	return matched;
+}
+
+#endif
+
+// Called with the display locked, or before the display is shared
+static void
+window_monitor_refresh(Display* display) {
+	window_monitor_cache_t cache;
+	memset(&cache, 0, sizeof(cache));
+#if WINDOW_ENABLE_XRANDR
+	if (window_monitor_xrandr)
+		window_monitor_query_xrandr(display, &cache);
+#endif
+	if (!cache.count) {
+		// Without RandR the default screen is the only monitor
+		int screen = DefaultScreen(display);
+		window_monitor_t* monitor = cache.monitor;
+		monitor->width = (uint32_t)DisplayWidth(display, screen);
+		monitor->height = (uint32_t)DisplayHeight(display, screen);
+		monitor->width_mm = (uint32_t)DisplayWidthMM(display, screen);
+		monitor->height_mm = (uint32_t)DisplayHeightMM(display, screen);
+		monitor->primary = 1;
+		string_copy(monitor->name, sizeof(monitor->name), STRING_CONST("default"));
+		cache.count = 1;
+	}
+
+	bool has_primary = false;
+	for (size_t imon = 0; imon < cache.count; ++imon) {
+		window_monitor_t* monitor = cache.monitor + imon;
+		// Physical size is unknown or bogus on projectors and virtual outputs
+		monitor->dpi = 96.0f;
+		if ((monitor->width_mm >= 20) && monitor->width)
+			monitor->dpi = ((float)monitor->width * 25.4f) / (float)monitor->width_mm;
+		float steps = (float)(int)(((monitor->dpi / 96.0f) * 4.0f) + 0.5f);
+		monitor->scale = (steps > 4.0f) ? (steps / 4.0f) : 1.0f;
+		has_primary = has_primary || monitor->primary;
+	}
+	// No output configured as primary, use the first monitor
+	if (!has_primary)
+		cache.monitor[0].primary = 1;
+
+	bool heads = false;
+#if WINDOW_ENABLE_XRANDR
+	heads = window_monitor_xrandr && window_monitor_query_heads(display, &cache);
+#endif
+	if (!heads) {
+		// Xinerama lists the primary monitor first, the others in order
+		unsigned int next = 1;
+		for (size_t imon = 0; imon < cache.count; ++imon)
+			cache.head[imon] = cache.monitor[imon].primary ? 0 : next++;
+	}
+
+	int32_t sequence = atomic_load32(&window_monitor_sequence, memory_order_relaxed) + 1;
+	window_monitor_published[sequence & 1] = cache;
+	atomic_store32(&window_monitor_sequence, sequence, memory_order_release);
+}
+
+static void
+window_monitor_initialize(Display* display) {
+#if WINDOW_ENABLE_XRANDR
+	// Current screen resources and primary output need RandR 1.3
+	int error_base, major = 1, minor = 3;
+	window_monitor_xrandr = XRRQueryExtension(display, &window_monitor_event_base, &error_base) &&
+	                        XRRQueryVersion(display, &major, &minor) && ((major > 1) || (minor >= 3));
+	// Monitor list matching the Xinerama heads needs RandR 1.5
+	window_monitor_xrandr_monitors = window_monitor_xrandr && ((major > 1) || (minor >= 5));
+	if (window_monitor_xrandr) {
+		for (int iscreen = 0, screens = ScreenCount(display); iscreen < screens; ++iscreen)
+			XRRSelectInput(display, RootWindow(display, iscreen),
+			               RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+	} else {
+		log_info(HASH_WINDOW, STRING_CONST("XRandR 1.3 not available, using screen size as only monitor"));
+	}
+#endif
+	window_monitor_dirty = false;
+	window_monitor_refresh(display);
+}
+
+// Monitor notifications are for the root window, returns true if the event was consumed. The cache
+// is refreshed once after the queue is drained
+static bool
+window_monitor_event(XEvent* event) {
+#if WINDOW_ENABLE_XRANDR
+	if (!window_monitor_xrandr)
+		return false;
+	if (event->type == window_monitor_event_base + RRScreenChangeNotify) {
+		// Updates the screen size Xlib reports for the root window
+		XRRUpdateConfiguration(event);
+		window_monitor_dirty = true;
+		return true;
+	}
+	if (event->type == window_monitor_event_base + RRNotify) {
+		window_monitor_dirty = true;
+		return true;
+	}
+#else
+	FOUNDATION_UNUSED(event);
+#endif
+	return false;
+}
+
+static void
+window_sync_initialize(Display* display) {
+	int event_base, error_base, major, minor;
+	window_sync_available =
+	    XSyncQueryExtension(display, &event_base, &error_base) && XSyncInitialize(display, &major, &minor);
+	if (!window_sync_available)
+		log_info(HASH_WINDOW, STRING_CONST("XSync not available, resizes are not synchronized with drawing"));
+}
+
+// Set the counter the window manager waits on, the value is the one from the sync request. Called with
+// the display locked
+static void
+window_sync_set_counter(window_t* window, uint64_t value) {
+	XSyncValue counter_value;
+	XSyncIntsToValue(&counter_value, (unsigned int)(value & 0xFFFFFFFFULL), (int)(value >> 32ULL));
+	XSyncSetCounter(window->display, (XSyncCounter)window->sync_counter, counter_value);
+}
+
+// Set the title as UTF-8 in both the EWMH and ICCCM name properties, no round trip. Called with the
+// display locked
+static void
+window_title_write(Display* display, Window drawable, const char* title, size_t length) {
+	XChangeProperty(display, drawable, window_atom_net_wm_name, window_atom_utf8_string, 8, PropModeReplace,
+	                (const unsigned char*)title, (int)length);
+	XChangeProperty(display, drawable, XA_WM_NAME, window_atom_utf8_string, 8, PropModeReplace,
+	                (const unsigned char*)title, (int)length);
+}
+
+// Write the latest queued title of each window with a pending update, older updates are never written.
+// Called from the message loop with the display locked
+static void
+window_title_flush(Display* display) {
+	if (!atomic_cas32(&window_title_pending, 0, 1, memory_order_acquire, memory_order_relaxed))
+		return;
+	char title[WINDOW_TITLE_CAPACITY];
+	bool written = false;
+	window_lock_list();
+	for (size_t iwin = 0, wsize = array_size(window_list); iwin < wsize; ++iwin) {
+		window_t* window = window_list[iwin];
+		if (!atomic_load32(&window->title_dirty, memory_order_acquire))
+			continue;
+		mutex_lock(window_title_mutex);
+		size_t length = window->title_length;
+		memcpy(title, window->title_buffer, length);
+		atomic_store32(&window->title_dirty, 0, memory_order_relaxed);
+		mutex_unlock(window_title_mutex);
+		window_title_write(display, window->drawable, title, length);
+		written = true;
+	}
+	window_unlock_list();
+	if (written)
+		XFlush(display);
+}
+
+static void
+window_loop_wake(void) {
+	if (window_wake_fd >= 0) {
+		uint64_t count = 1;
+		ssize_t res = write(window_wake_fd, &count, sizeof(count));
+		FOUNDATION_UNUSED(res);
+	}
+}
+
+static Display*
+window_open_display(void) {
+	// TODO: Only default display supported right now. When multiple display support is added, the event
+	//       loop must be refactored to one thread per display to maintain blocking
+	if (!window_default_display) {
+		window_default_display = XOpenDisplay(0);
+		if (window_default_display) {
+			window_keymap_initialize(window_default_display);
+			window_monitor_initialize(window_default_display);
+			window_sync_initialize(window_default_display);
+#if WINDOW_ENABLE_XINPUT2
+			window_xinput_initialize(window_default_display);
+#endif
+		}
+	}
+	if (!window_default_display)
+		log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to open X display"));
+	return window_default_display;
+}
+
+// Copy one monitor and its Xinerama head index from the published cache, false if out of range
+static bool
+window_monitor_head(unsigned int index, window_monitor_t* monitor, unsigned int* head) {
+	if (!atomic_load32(&window_monitor_sequence, memory_order_acquire))
+		return false;
+	while (true) {
+		int32_t sequence = atomic_load32(&window_monitor_sequence, memory_order_acquire);
+		const window_monitor_cache_t* cache = window_monitor_published + (sequence & 1);
+		bool valid = (index < cache->count) && (index < WINDOW_MONITOR_LIMIT);
+		if (valid) {
+			*monitor = cache->monitor[index];
+			*head = cache->head[index];
+		}
+		atomic_thread_fence_acquire();
+		if (atomic_load32(&window_monitor_sequence, memory_order_relaxed) == sequence)
+			return valid;
+	}
+}
+
+size_t
+window_monitors(window_monitor_t* monitors, size_t capacity) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland)
+		return window_wayland_monitors(monitors, capacity);
+#endif
+	if (!atomic_load32(&window_monitor_sequence, memory_order_acquire) && !window_open_display())
+		return 0;
+	while (true) {
+		int32_t sequence = atomic_load32(&window_monitor_sequence, memory_order_acquire);
+		const window_monitor_cache_t* cache = window_monitor_published + (sequence & 1);
+		size_t count = cache->count;
+		size_t copy = (count < capacity) ? count : capacity;
+		if (copy > WINDOW_MONITOR_LIMIT)
+			copy = WINDOW_MONITOR_LIMIT;
+		if (copy)
+			memcpy(monitors, cache->monitor, sizeof(window_monitor_t) * copy);
+		atomic_thread_fence_acquire();
+		if (atomic_load32(&window_monitor_sequence, memory_order_relaxed) == sequence)
+			return count;
+	}
+}
+
+// Atoms are interned once in a single batch, later creates and fullscreen toggles do not need the
+// round trips. Called with the display locked
+static void
+window_intern_atoms(Display* display) {
+	if (!window_atom_delete) {
+		char* names[] = {"WM_DELETE_WINDOW", "WM_PROTOCOLS", "_NET_WM_STATE", "_NET_WM_STATE_FULLSCREEN",
+		                 "_NET_WM_FULLSCREEN_MONITORS", "_NET_WM_BYPASS_COMPOSITOR", "_NET_WM_SYNC_REQUEST",
+		                 "_NET_WM_SYNC_REQUEST_COUNTER", "_NET_WM_NAME", "UTF8_STRING", "_NET_WM_STATE_MAXIMIZED_HORZ",
+		                 "_NET_WM_STATE_MAXIMIZED_VERT", "_NET_WM_STATE_HIDDEN", "WM_CHANGE_STATE"};
+		Atom atoms[sizeof(names) / sizeof(names[0])];
+		XInternAtoms(display, names, (int)(sizeof(names) / sizeof(names[0])), False, atoms);
+		window_atom_delete = atoms[0];
+		window_atom_protocols = atoms[1];
+		window_atom_wm_state = atoms[2];
+		window_atom_fullscreen = atoms[3];
+		window_atom_fullscreen_monitors = atoms[4];
+		window_atom_bypass_compositor = atoms[5];
+		window_atom_sync_request = atoms[6];
+		window_atom_sync_request_counter = atoms[7];
+		window_atom_net_wm_name = atoms[8];
+		window_atom_utf8_string = atoms[9];
+		window_atom_maximized_horz = atoms[10];
+		window_atom_maximized_vert = atoms[11];
+		window_atom_hidden = atoms[12];
+		window_atom_change_state = atoms[13];
+		WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_CREATE, 1);
+	}
+}
+
+// Ask compositing window managers to unredirect the window while fullscreen (1), or return to no
+// preference (0). Called with the display locked
+static void
+window_bypass_compositor(window_t* window, bool bypass) {
+	long value = bypass ? 1 : 0;
+	XChangeProperty(window->display, window->drawable, window_atom_bypass_compositor, XA_CARDINAL, 32,
+	                PropModeReplace, (unsigned char*)&value, 1);
+}
+
+// Structure, expose and focus events drive the window state events and are always selected, input only
+// when enabled for the window or needed by its event consumers
+static long
+window_event_mask(window_t* window) {
+	unsigned int input = window->input | window_event_input(window);
+	long mask = ExposureMask | StructureNotifyMask | VisibilityChangeMask | FocusChangeMask;
+	if (input & WINDOW_INPUT_KEYBOARD)
+		mask |= KeyPressMask | KeyReleaseMask | KeymapStateMask;
+	if (input & WINDOW_INPUT_BUTTON)
+		mask |= ButtonPressMask | ButtonReleaseMask;
+	// Pointer motion includes motion with buttons held
+	if (input & WINDOW_INPUT_MOTION)
+		mask |= PointerMotionMask;
+	if (input & WINDOW_INPUT_CROSSING)
+		mask |= EnterWindowMask | LeaveWindowMask;
+	return mask;
+}
+
+void
+window_native_input_update(window_t* window) {
+	if (!window || !window->created || !window->drawable || window->wayland)
+		return;
+	window_lock_display(window->display);
+	long mask = window_event_mask(window);
+	if (mask != window->event_mask) {
+		XSelectInput(window->display, window->drawable, mask);
+		XFlush(window->display);
+		window->event_mask = mask;
+	}
+#if WINDOW_ENABLE_XINPUT2
+	window_xinput_select(window);
+#endif
+	window_unlock_display(window->display);
+}
+
+// Confine the pointer to the window while the cursor is locked. Fails while the window is not viewable,
+// retried when the window gets focus. Called with the display locked
+static void
+window_cursor_grab(window_t* window) {
+	unsigned int mask = ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+	window->cursor_grabbed = (XGrabPointer(window->display, window->drawable, True, mask, GrabModeAsync,
+	                                       GrabModeAsync, window->drawable, None, CurrentTime) == GrabSuccess);
+}
+
+// Queue the requests creating and mapping the drawable, no round trips. Top level windows get window
+// manager properties, child windows only the drawable. Called with the display locked
+static void
+window_create_drawable(window_t* window, Display* display, int screen, Window parent, int x, int y,
+                       XVisualInfo* visual, Colormap colormap, bool toplevel, const char* title, unsigned int width,
+                       unsigned int height, unsigned int flags) {
+	if (!title)
+		title = "";
+	window->input = window_input_default;
+	window->input_context_pending = false;
+	window->parent = 0;
+	window->children = 0;
+	window->event_mask = window_event_mask(window);
+	window->xi_input = 0;
+	window->fullscreen = (toplevel && (flags & WINDOW_FLAG_FULLSCREEN));
+	window->sync_counter = 0;
+	window->sync_request = 0;
+	window->sync_value = 0;
+	window->sync_requested = false;
+	window->sync_pending = false;
+	atomic_store32(&window->title_dirty, 0, memory_order_relaxed);
+	window->title_length = 0;
+	window->title_buffer = 0;
+	window->cursor_hidden = false;
+	window->cursor_lock = false;
+	window->cursor_grabbed = false;
+	window->input_dirty = false;
+	atomic_store32(&window->input_sequence, 0, memory_order_relaxed);
+	memset(&window->input_live, 0, sizeof(window->input_live));
+	memset(window->input_published, 0, sizeof(window->input_published));
+
+	XSetWindowAttributes attrib;
+	attrib.colormap = colormap;
+	attrib.background_pixel = 0;
+	attrib.border_pixel = 0;
+	attrib.event_mask = window->event_mask;
+	Window drawable = XCreateWindow(display, parent, x, y, (unsigned int)width, (unsigned int)height, 0,
+	                                visual->depth, InputOutput, visual->visual,
+	                                CWBackPixel | CWBorderPixel | CWColormap | CWEventMask, &attrib);
+
+	if (toplevel) {
+		XSizeHints sizehints;
+		memset(&sizehints, 0, sizeof(sizehints));
+		sizehints.base_width = (int)width;
+		sizehints.base_height = (int)height;
+		sizehints.flags = PBaseSize;
+		XSetStandardProperties(display, drawable, title, title, None, 0, 0, &sizehints);
+		// Replaces the Latin-1 name set above
+		window_title_write(display, drawable, title, string_length(title));
+
+		// Same as XSetWMProtocols without its atom lookup. The sync counter is a client side XID,
+		// creating it does not wait for the server
+		Atom protocols[2] = {window_atom_delete, window_atom_sync_request};
+		int protocol_count = 1;
+		if (window_sync_available && (flags & WINDOW_FLAG_SYNCRESIZE)) {
+			XSyncValue zero;
+			XSyncIntToValue(&zero, 0);
+			window->sync_counter = XSyncCreateCounter(display, zero);
+			long counter = (long)window->sync_counter;
+			XChangeProperty(display, drawable, window_atom_sync_request_counter, XA_CARDINAL, 32, PropModeReplace,
+			                (unsigned char*)&counter, 1);
+			++protocol_count;
+		}
+		XChangeProperty(display, drawable, window_atom_protocols, XA_ATOM, 32, PropModeReplace,
+		                (unsigned char*)protocols, protocol_count);
+
+		// Initial state is read by the window manager when the window is first mapped
+		if (window->fullscreen)
+			XChangeProperty(display, drawable, window_atom_wm_state, XA_ATOM, 32, PropModeReplace,
+			                (unsigned char*)&window_atom_fullscreen, 1);
+	}
+
+	window->display = display;
+	window->visual = visual;
+	window->colormap = colormap;
+	window->screen = (unsigned int)screen;
+	window->drawable = drawable;
+	window->created = true;
+	window->mapped = false;
+	window->atom_delete = toplevel ? window_atom_delete : 0;
+	if (window->fullscreen)
+		window_bypass_compositor(window, true);
+
+	// Register for event routing before the loop can see events for the drawable
+	window_handle_acquire(window);
+	XSaveContext(display, drawable, window_context, (XPointer)window);
+#if WINDOW_ENABLE_XINPUT2
+	window_xinput_select(window);
+#endif
 
-window_t*
-window_allocate(void) {
-	window_t* window = memory_allocate(HASH_WINDOW, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
-	return window;
+	if (!(flags & WINDOW_FLAG_NOSHOW)) {
+		XMapWindow(display, drawable);
+		if (toplevel)
+			XRaiseWindow(display, drawable);
+	}
 }
 
-void
-window_create(window_t* window, unsigned int adapter, const char* title, size_t length, unsigned int width,
-              unsigned int height, unsigned int flags) {
-	FOUNDATION_UNUSED(length);
+static void
+window_create_x11(window_t* window, unsigned int adapter, const char* title, unsigned int width, unsigned int height,
+                  unsigned int flags, bool async) {
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_CREATE);
 
-	// TODO: Only default display supported right now. When multiple display support is added, the event
-	//       loop must be refactored to one thread per display to maintain blocking
-	Display* display = window_default_display;
-	if (!display) {
-		window_default_display = XOpenDisplay(0);
-		display = window_default_display;
-	}
-	if (!display) {
-		log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to open X display"));
+	Display* display = window_open_display();
+	if (!display)
 		return;
-	}
 
-	XLockDisplay(display);
+	window_lock_display(display);
 
 	int screen = (adapter != WINDOW_ADAPTER_DEFAULT) ? (int)adapter : DefaultScreen(display);
 	XVisualInfo* visual = window_get_xvisual(display, screen, 24, 16, 0);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_CREATE, 1);
 	if (!visual) {
-		XUnlockDisplay(display);
+		window_unlock_display(display);
 		log_errorf(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to get X visual for screen %d"), screen);
 		return;
 	}
 
+	window_intern_atoms(display);
+
 	Colormap colormap = XCreateColormap(display, XRootWindow(display, screen), visual->visual, AllocNone);
 
 	log_debugf(HASH_WINDOW, STRING_CONST("Creating window on screen %d with dimensions %ux%u"), screen, width, height);
 
-	XSetWindowAttributes attrib;
-	attrib.colormap = colormap;
-	attrib.background_pixel = 0;
-	attrib.border_pixel = 0;
-	attrib.event_mask = ExposureMask | StructureNotifyMask | ButtonPressMask | ButtonReleaseMask | EnterWindowMask |
-	                    LeaveWindowMask | PointerMotionMask | Button1MotionMask | Button2MotionMask |
-	                    Button3MotionMask | Button4MotionMask | Button5MotionMask | ButtonMotionMask | KeyPressMask |
-	                    KeyReleaseMask | KeymapStateMask | VisibilityChangeMask | FocusChangeMask;
-	Window drawable = XCreateWindow(display, XRootWindow(display, screen), 0, 0, (unsigned int)width,
-	                                (unsigned int)height, 0, visual->depth, InputOutput, visual->visual,
-	                                CWBackPixel | CWBorderPixel | CWColormap | CWEventMask, &attrib);
+	window->shared_visual = false;
+	// Without a map there is no notification to wait for
+	window->create_pending = async && !(flags & WINDOW_FLAG_NOSHOW);
+	window_create_drawable(window, display, screen, XRootWindow(display, screen), 0, 0, visual, colormap, true, title,
+	                       width, height, flags);
 
-	XSizeHints* sizehints = XAllocSizeHints();
-	if (sizehints) {
-		sizehints->base_width = (int)width;
-		sizehints->base_height = (int)height;
-		sizehints->flags = PBaseSize;
+	if (async) {
+		window->input_context_pending = true;
+		XFlush(display);
+	} else {
+		XSync(display, False);
+		WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_CREATE, 1);
+		window_create_input_context(window, WINDOW_STATS_CALL_CREATE);
 	}
-	XSetStandardProperties(display, drawable, title, title, None, 0, 0, sizehints);
-	if (sizehints)
-		XFree(sizehints);
 
-	if (!(flags & WINDOW_FLAG_NOSHOW)) {
-		XMapWindow(display, drawable);
-		XRaiseWindow(display, drawable);
-		XFlush(display);
+	// Once the display is unlocked the loop can handle the map and clear the flag, posting the event itself
+	bool pending = window->create_pending;
+
+	window_unlock_display(display);
+
+	window_add(window);
+
+	if (!pending)
+		window_event_post(WINDOWEVENT_CREATE, window);
+}
+
+void
+window_create(window_t* window, unsigned int adapter, const char* title, size_t length, unsigned int width,
+              unsigned int height, unsigned int flags) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland) {
+		FOUNDATION_UNUSED(adapter);
+		window_wayland_create(window, title, length, width, height, flags);
+		return;
 	}
+#endif
+	FOUNDATION_UNUSED(length);
+	window_create_x11(window, adapter, title, width, height, flags, false);
+}
 
-	Atom atom_delete = XInternAtom(display, "WM_DELETE_WINDOW", False);
-	XSetWMProtocols(display, drawable, &atom_delete, 1);
-	XFlush(display);
-	XSync(display, False);
+void
+window_create_async(window_t* window, unsigned int adapter, const char* title, size_t length, unsigned int width,
+                    unsigned int height, unsigned int flags) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland) {
+		// Wayland surfaces are created without blocking on the compositor already
+		FOUNDATION_UNUSED(adapter);
+		window_wayland_create(window, title, length, width, height, flags);
+		return;
+	}
+#endif
+	FOUNDATION_UNUSED(length);
+	window_create_x11(window, adapter, title, width, height, flags, true);
+}
 
-	XIC xic = 0;
-	XIM xim = XOpenIM(display, 0, 0, 0);
-	if (xim) {
-		xic = XCreateIC(xim, XNInputStyle, XIMPreeditNone | XIMStatusNone, XNClientWindow, drawable, nullptr);
-		if (xic) {
-			/*XGetICValues(ic, XNFilterEvents, &fevent, NULL);
-			mask = ExposureMask | KeyPressMask | FocusChangeMask;
-			XSelectInput(display, window, mask|fevent);*/
-		} else {
-			log_warn(HASH_WINDOW, WARNING_SUSPICIOUS, STRING_CONST("Unable to create X input context"));
+size_t
+window_create_batch(const window_create_info_t* infos, size_t count, window_t** out) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland) {
+		for (size_t iwin = 0; iwin < count; ++iwin) {
+			out[iwin] = window_allocate();
+			window_wayland_create(out[iwin], infos[iwin].title, infos[iwin].length, infos[iwin].width,
+			                      infos[iwin].height, infos[iwin].flags);
 		}
-	} else {
-		log_warn(HASH_WINDOW, WARNING_SUSPICIOUS, STRING_CONST("Unable to open X input method"));
+		return count;
 	}
+#endif
+	Display* display = window_open_display();
+	if (!display)
+		return 0;
+
+	window_lock_display(display);
+
+	window_intern_atoms(display);
+
+	// Issue all create and map requests in one burst using the shared visual and colormap of each screen
+	size_t created = 0;
+	for (size_t iwin = 0; iwin < count; ++iwin) {
+		const window_create_info_t* info = infos + iwin;
+		WINDOW_STATS_CALL(WINDOW_STATS_CALL_CREATE);
+		int screen = (info->adapter != WINDOW_ADAPTER_DEFAULT) ? (int)info->adapter : DefaultScreen(display);
+		if ((screen < 0) || (screen >= WINDOW_SHARED_SCREENS) || (screen >= ScreenCount(display))) {
+			log_errorf(HASH_WINDOW, ERROR_INVALID_VALUE, STRING_CONST("Invalid screen %d for batch window"), screen);
+			out[iwin] = 0;
+			continue;
+		}
+		if (!window_shared_visual[screen]) {
+			window_shared_visual[screen] = window_get_xvisual(display, screen, 24, 16, 0);
+			WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_CREATE, 1);
+			if (window_shared_visual[screen])
+				window_shared_colormap[screen] = XCreateColormap(display, XRootWindow(display, screen),
+				                                                 window_shared_visual[screen]->visual, AllocNone);
+		}
+		if (!window_shared_visual[screen]) {
+			log_errorf(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Unable to get X visual for screen %d"),
+			           screen);
+			out[iwin] = 0;
+			continue;
+		}
 
-	XUnlockDisplay(display);
+		window_t* window = window_allocate();
+		window->shared_visual = true;
+		window->create_pending = false;
+		window_create_drawable(window, display, screen, XRootWindow(display, screen), 0, 0,
+		                       window_shared_visual[screen], window_shared_colormap[screen], true, info->title,
+		                       info->width, info->height, info->flags);
+		// Each input context is a round trip to the input method server, created when the window is mapped
+		window->input_context_pending = true;
+		out[iwin] = window;
+		++created;
+	}
 
-	window->display = display;
-	window->visual = visual;
-	window->screen = (unsigned int)screen;
-	window->drawable = drawable;
-	window->xim = xim;
-	window->xic = xic;
-	window->created = true;
-	window->atom_delete = atom_delete;
+	XSync(display, False);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_CREATE, 1);
+
+	window_unlock_display(display);
+
+	for (size_t iwin = 0; iwin < count; ++iwin) {
+		if (!out[iwin])
+			continue;
+		window_add(out[iwin]);
+		window_event_post(WINDOWEVENT_CREATE, out[iwin]);
+	}
+
+	return created;
+}
+
+window_t*
+window_create_child(window_t* parent, int x, int y, unsigned int width, unsigned int height, unsigned int flags) {
+#if WINDOW_ENABLE_WAYLAND
+	if (parent->wayland) {
+		log_error(HASH_WINDOW, ERROR_UNSUPPORTED, STRING_CONST("Child windows are not supported on Wayland"));
+		return 0;
+	}
+#endif
+	if (!parent->created || !parent->drawable)
+		return 0;
+
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_CREATE);
+
+	// No window manager properties, input context or sync, the requests are only queued
+	window_t* window = window_allocate();
+	Display* display = parent->display;
+	window_lock_display(display);
+	window->shared_visual = true;
+	window->create_pending = false;
+	window_create_drawable(window, display, (int)parent->screen, parent->drawable, x, y, parent->visual,
+	                       parent->colormap, false, nullptr, width, height, flags);
+	XFlush(display);
+	window_unlock_display(display);
+
+	window_lock_list();
+	window->parent = parent;
+	array_push(parent->children, window);
+	window_unlock_list();
 
 	window_add(window);
 
 	window_event_post(WINDOWEVENT_CREATE, window);
+	return window;
 }
 
 void*
 window_display(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland)
+		return window->wl_display;
+#endif
 	return window->display;
 }
 
@@ -201,6 +1659,10 @@ window_screen(window_t* window) {
 
 unsigned long
 window_drawable(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland)
+		return (unsigned long)(uintptr_t)window_wayland_surface(window);
+#endif
 	return window->drawable;
 }
 
@@ -211,37 +1673,112 @@ window_visual(window_t* window) {
 
 void
 window_finalize(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_finalize_window(window);
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_FINALIZE);
+
+	// The server destroys children with the parent, finalize them while their drawables and the shared
+	// visual are still valid. Each child removes itself from the array
+	while (true) {
+		window_lock_list();
+		size_t count = array_size(window->children);
+		window_t* child = count ? window->children[count - 1] : 0;
+		window_unlock_list();
+		if (!child)
+			break;
+		window_finalize(child);
+	}
+	array_deallocate(window->children);
+	window->children = 0;
+
+	if (window->parent) {
+		window_lock_list();
+		for (size_t ichild = 0, csize = array_size(window->parent->children); ichild < csize; ++ichild) {
+			if (window->parent->children[ichild] == window) {
+				array_erase(window->parent->children, ichild);
+				break;
+			}
+		}
+		window_unlock_list();
+		window->parent = 0;
+	}
+
 	if (window->created)
 		window_remove(window);
 
 	if (window->display)
-		XLockDisplay(window->display);
+		window_lock_display(window->display);
 
 	if (window->created && window->drawable) {
+		XDeleteContext(window->display, window->drawable, window_context);
+		if (window->xic)
+			XDestroyIC(window->xic);
 		XDestroyWindow(window->display, window->drawable);
+		if (window->sync_counter)
+			XSyncDestroyCounter(window->display, (XSyncCounter)window->sync_counter);
 		XFlush(window->display);
 		XSync(window->display, False);
+		WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_FINALIZE, 1);
 		window_event_post(WINDOWEVENT_DESTROY, window);
 	}
+#if WINDOW_ENABLE_XINPUT2
+	// Window is no longer in the list, stop raw motion if it was the last window wanting it
+	if (window->created && (window->xi_input & WINDOW_INPUT_RAW))
+		window_xinput_select_raw(window->display, 0);
+#endif
+	window->xi_input = 0;
+	window->sync_counter = 0;
+	window->sync_requested = false;
+	window->sync_pending = false;
+	// Destroying the drawable released the grab
+	window->cursor_hidden = false;
+	window->cursor_lock = false;
+	window->cursor_grabbed = false;
 	window->drawable = 0;
-
-	if (window->created && window->visual) {
-		XFree(window->visual);
-		XSync(window->display, True);
+	window->xic = 0;
+	window->xim = 0;
+	window->input_context_pending = false;
+	if (window->created)
+		window_handle_release(window);
+
+	// Shared visual and colormap are owned by window_native_finalize or the parent window
+	if (window->created && !window->shared_visual) {
+		if (window->colormap)
+			XFreeColormap(window->display, window->colormap);
+		if (window->visual)
+			XFree(window->visual);
 	}
 	window->visual = 0;
-
-	if (window->display) {
-		XUnlockDisplay(window->display);
-		XCloseDisplay(window->display);
+	window->colormap = 0;
+	window->shared_visual = false;
+
+	if (window->pointer_history)
+		memory_deallocate(window->pointer_history);
+	window->pointer_history = 0;
+
+	if (window->title_buffer) {
+		mutex_lock(window_title_mutex);
+		memory_deallocate(window->title_buffer);
+		window->title_buffer = 0;
+		atomic_store32(&window->title_dirty, 0, memory_order_relaxed);
+		mutex_unlock(window_title_mutex);
 	}
+
+	// Display is shared by all windows and closed in window_native_finalize
+	if (window->display)
+		window_unlock_display(window->display);
 	window->display = 0;
+	window->created = false;
 }
 
 void
 window_deallocate(window_t* window) {
 	window_finalize(window);
-	memory_deallocate(window);
+	window_pool_deallocate(window);
 }
 
 unsigned int
@@ -250,65 +1787,117 @@ window_adapter(window_t* window) {
 	return WINDOW_ADAPTER_DEFAULT;
 }
 
+// Primary monitor for the default screen, the full size of other screens
+static bool
+window_screen_monitor(unsigned int adapter, window_monitor_t* monitor) {
+	window_monitor_t monitors[WINDOW_MONITOR_LIMIT];
+	size_t count = window_monitors(monitors, WINDOW_MONITOR_LIMIT);
+	if (!count)
+		return false;
+	// No X display is opened on Wayland, where all outputs belong to the one screen
+	Display* display = window_default_display;
+	int screen = (int)adapter;
+	if (display && (adapter != WINDOW_ADAPTER_DEFAULT) && (screen != DefaultScreen(display)) &&
+	    (screen < ScreenCount(display))) {
+		memset(monitor, 0, sizeof(window_monitor_t));
+		monitor->width = (uint32_t)DisplayWidth(display, screen);
+		monitor->height = (uint32_t)DisplayHeight(display, screen);
+		return true;
+	}
+	if (count > WINDOW_MONITOR_LIMIT)
+		count = WINDOW_MONITOR_LIMIT;
+	*monitor = monitors[0];
+	for (size_t imon = 0; imon < count; ++imon) {
+		if (monitors[imon].primary)
+			*monitor = monitors[imon];
+	}
+	return true;
+}
+
 int
 window_screen_width(unsigned int adapter) {
-	FOUNDATION_UNUSED(adapter);
-	return 800;
+	window_monitor_t monitor;
+	return window_screen_monitor(adapter, &monitor) ? (int)monitor.width : 0;
 }
 
 int
 window_screen_height(unsigned int adapter) {
-	FOUNDATION_UNUSED(adapter);
-	return 600;
+	window_monitor_t monitor;
+	return window_screen_monitor(adapter, &monitor) ? (int)monitor.height : 0;
 }
 
 void
 window_maximize(window_t* window) {
-	XLockDisplay(window->display);
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_maximize(window);
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_MAXIMIZE);
+	window_lock_display(window->display);
 
 	XEvent event = {0};
-	Atom atom_wmstate = XInternAtom(window->display, "_NET_WM_STATE", False);
-	Atom atom_horizontal = XInternAtom(window->display, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
-	Atom atom_vertical = XInternAtom(window->display, "_NET_WM_STATE_MAXIMIZED_VERT", False);
-
 	event.type = ClientMessage;
 	event.xclient.window = window->drawable;
-	event.xclient.message_type = atom_wmstate;
+	event.xclient.message_type = window_atom_wm_state;
 	event.xclient.format = 32;
 	event.xclient.data.l[0] = _NET_WM_STATE_ADD;
-	event.xclient.data.l[1] = (long)atom_horizontal;
-	event.xclient.data.l[2] = (long)atom_vertical;
+	event.xclient.data.l[1] = (long)window_atom_maximized_horz;
+	event.xclient.data.l[2] = (long)window_atom_maximized_vert;
 
 	XSendEvent(window->display, XRootWindow(window->display, (int)window->screen), False, SubstructureNotifyMask,
 	           &event);
 	XFlush(window->display);
 	XSync(window->display, False);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_MAXIMIZE, 1);
 
-	XUnlockDisplay(window->display);
+	window_unlock_display(window->display);
 }
 
 void
 window_minimize(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_minimize(window);
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_MINIMIZE);
 	if (window_is_minimized(window))
 		return;
-	XLockDisplay(window->display);
-	XIconifyWindow(window->display, window->drawable, (int)window->screen);
+	window_lock_display(window->display);
+	// Same as XIconifyWindow without its atom lookup
+	XEvent event = {0};
+	event.type = ClientMessage;
+	event.xclient.window = window->drawable;
+	event.xclient.message_type = window_atom_change_state;
+	event.xclient.format = 32;
+	event.xclient.data.l[0] = IconicState;
+	XSendEvent(window->display, XRootWindow(window->display, (int)window->screen), False,
+	           SubstructureRedirectMask | SubstructureNotifyMask, &event);
 	XFlush(window->display);
 	XSync(window->display, False);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_MINIMIZE, 1);
+	window_unlock_display(window->display);
 	window_event_post(WINDOWEVENT_RESIZE, window);
 }
 
 void
 window_restore(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_restore(window);
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_RESTORE);
 	if (window_is_minimized(window)) {
-		XLockDisplay(window->display);
+		window_lock_display(window->display);
 		XEvent event = {0};
-		Atom atom_changestate = XInternAtom(window->display, "WM_CHANGE_STATE", False);
-
 		event.type = ClientMessage;
 		event.xclient.window = window->drawable;
-		event.xclient.message_type = atom_changestate;
+		event.xclient.message_type = window_atom_change_state;
 		event.xclient.format = 32;
 		event.xclient.data.l[0] = NormalState;
 
@@ -322,52 +1911,70 @@ window_restore(window_t* window) {
 		XSetInputFocus(window->display, window->drawable, RevertToParent, CurrentTime);
 		XFlush(window->display);
 		XSync(window->display, False);
-		XUnlockDisplay(window->display);
+		WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_RESTORE, 2);
+		window_unlock_display(window->display);
 	} else if (window_is_maximized(window)) {
-		XLockDisplay(window->display);
+		window_lock_display(window->display);
 		XEvent event = {0};
-		Atom atom_wmstate = XInternAtom(window->display, "_NET_WM_STATE", False);
-		Atom atom_horizontal = XInternAtom(window->display, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
-		Atom atom_vertical = XInternAtom(window->display, "_NET_WM_STATE_MAXIMIZED_VERT", False);
-
 		event.type = ClientMessage;
 		event.xclient.window = window->drawable;
-		event.xclient.message_type = atom_wmstate;
+		event.xclient.message_type = window_atom_wm_state;
 		event.xclient.format = 32;
 		event.xclient.data.l[0] = _NET_WM_STATE_REMOVE;
-		event.xclient.data.l[1] = (long)atom_horizontal;
-		event.xclient.data.l[2] = (long)atom_vertical;
+		event.xclient.data.l[1] = (long)window_atom_maximized_horz;
+		event.xclient.data.l[2] = (long)window_atom_maximized_vert;
 
 		XSendEvent(window->display, XRootWindow(window->display, (int)window->screen), False, SubstructureNotifyMask,
 		           &event);
 		XFlush(window->display);
 		XSync(window->display, False);
-		XUnlockDisplay(window->display);
+		WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_RESTORE, 1);
+		window_unlock_display(window->display);
 	}
 }
 
 void
 window_resize(window_t* window, int width, int height) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_resize(window, width, height);
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_RESIZE);
 	window_restore(window);
-	XLockDisplay(window->display);
+	window_lock_display(window->display);
 	XResizeWindow(window->display, window->drawable, (unsigned int)width, (unsigned int)height);
 	XFlush(window->display);
 	XSync(window->display, False);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_RESIZE, 1);
+	window_unlock_display(window->display);
 }
 
 void
 window_move(window_t* window, int x, int y) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		// Wayland clients cannot position toplevels
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_MOVE);
 	window_restore(window);
-	XLockDisplay(window->display);
+	window_lock_display(window->display);
 	XMoveWindow(window->display, window->drawable, x, y);
 	XFlush(window->display);
 	XSync(window->display, False);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_MOVE, 1);
+	window_unlock_display(window->display);
 }
 
 bool
 window_is_open(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window && window->wayland)
+		return (window->wl_surface != 0);
+#endif
 	return window && (window->drawable != 0);
 }
 
@@ -379,20 +1986,24 @@ window_is_visible(window_t* window) {
 
 bool
 window_is_maximized(window_t* window) {
-	XLockDisplay(window->display);
-	Atom atom_wmstate = XInternAtom(window->display, "_NET_WM_STATE", False);
-	Atom atom_horizontal = XInternAtom(window->display, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
-
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return window_wayland_is_maximized(window);
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_IS_MAXIMIZED);
+	window_lock_display(window->display);
 	Atom actual_type;
 	int actual_format;
 	unsigned long i, items_count, bytes_after;
 	Atom* atoms = 0;
 	bool is_maximized = false;
 
-	XGetWindowProperty(window->display, window->drawable, atom_wmstate, 0, 32, False, XA_ATOM, &actual_type,
+	XGetWindowProperty(window->display, window->drawable, window_atom_wm_state, 0, 32, False, XA_ATOM, &actual_type,
 	                   &actual_format, &items_count, &bytes_after, (unsigned char**)&atoms);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_IS_MAXIMIZED, 1);
 	for (i = 0; i < items_count; ++i) {
-		if (atoms[i] == atom_horizontal) {
+		if (atoms[i] == window_atom_maximized_horz) {
 			is_maximized = true;
 			break;
 		}
@@ -400,27 +2011,31 @@ window_is_maximized(window_t* window) {
 
 	if (atoms)
 		XFree(atoms);
-	XUnlockDisplay(window->display);
+	window_unlock_display(window->display);
 
 	return is_maximized;
 }
 
 bool
 window_is_minimized(window_t* window) {
-	XLockDisplay(window->display);
-	Atom atom_wmstate = XInternAtom(window->display, "_NET_WM_STATE", False);
-	Atom atom_hidden = XInternAtom(window->display, "_NET_WM_STATE_HIDDEN", False);
-
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return false;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_IS_MINIMIZED);
+	window_lock_display(window->display);
 	Atom actual_type;
 	int actual_format;
 	unsigned long i, items_count, bytes_after;
 	Atom* atoms = 0;
 	bool is_minimized = false;
 
-	XGetWindowProperty(window->display, window->drawable, atom_wmstate, 0, 32, False, XA_ATOM, &actual_type,
+	XGetWindowProperty(window->display, window->drawable, window_atom_wm_state, 0, 32, False, XA_ATOM, &actual_type,
 	                   &actual_format, &items_count, &bytes_after, (unsigned char**)&atoms);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_IS_MINIMIZED, 1);
 	for (i = 0; i < items_count; ++i) {
-		if (atoms[i] == atom_hidden) {
+		if (atoms[i] == window_atom_hidden) {
 			is_minimized = true;
 			break;
 		}
@@ -428,95 +2043,365 @@ window_is_minimized(window_t* window) {
 
 	if (atoms)
 		XFree(atoms);
-	XUnlockDisplay(window->display);
+	window_unlock_display(window->display);
 
 	return is_minimized;
 }
 
 bool
 window_has_focus(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return window->focus;
+	}
+#endif
 	Window focus;
 	int revert;
-	XLockDisplay(window->display);
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_HAS_FOCUS);
+	window_lock_display(window->display);
 	XGetInputFocus(window->display, &focus, &revert);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_HAS_FOCUS, 1);
+	window_unlock_display(window->display);
 	return focus == window->drawable;
 }
 
 void
 window_show_cursor(window_t* window, bool show, bool lock) {
-	FOUNDATION_UNUSED(window);
-	FOUNDATION_UNUSED(show);
-	FOUNDATION_UNUSED(lock);
+	if (window->wayland || !window->drawable)
+		return;
+	window_lock_display(window->display);
+
+	// Hide with an invisible cursor on the window, so the cursor shows again when it leaves the window
+	if (!show && !window->cursor_hidden) {
+		if (!window_blank_cursor) {
+			Pixmap pixmap = XCreatePixmap(window->display, window->drawable, 1, 1, 1);
+			XColor black;
+			memset(&black, 0, sizeof(black));
+			window_blank_cursor = XCreatePixmapCursor(window->display, pixmap, pixmap, &black, &black, 0, 0);
+			XFreePixmap(window->display, pixmap);
+		}
+		XDefineCursor(window->display, window->drawable, window_blank_cursor);
+		window->cursor_hidden = true;
+	} else if (show && window->cursor_hidden) {
+		XUndefineCursor(window->display, window->drawable);
+		window->cursor_hidden = false;
+	}
+
+	if (lock != window->cursor_lock) {
+		window->cursor_lock = lock;
+		if (lock && window->focus) {
+			window_cursor_grab(window);
+		} else if (!lock && window->cursor_grabbed) {
+			XUngrabPointer(window->display, CurrentTime);
+			window->cursor_grabbed = false;
+		}
+#if WINDOW_ENABLE_XINPUT2
+		// Relative motion of a locked cursor is reported as raw motion
+		window_xinput_select(window);
+		if (lock && !window_xinput_available)
+			log_warn(HASH_WINDOW, WARNING_UNSUPPORTED,
+			         STRING_CONST("XInput 2.1 not available, no relative motion for locked cursor"));
+#else
+		if (lock)
+			log_warn(HASH_WINDOW, WARNING_UNSUPPORTED,
+			         STRING_CONST("Built without XInput2, no relative motion for locked cursor"));
+#endif
+	}
+
+	XFlush(window->display);
+	window_unlock_display(window->display);
 }
 
 void
 window_set_cursor_pos(window_t* window, int x, int y) {
-	FOUNDATION_UNUSED(window);
-	FOUNDATION_UNUSED(x);
-	FOUNDATION_UNUSED(y);
+	if (window->wayland || !window->drawable)
+		return;
+	window_lock_display(window->display);
+	XWarpPointer(window->display, None, window->drawable, 0, 0, 0, 0, x, y);
+	XFlush(window->display);
+	window_unlock_display(window->display);
 }
 
 bool
 window_is_cursor_locked(window_t* window) {
-	FOUNDATION_UNUSED(window);
-	return false;
+	return window->cursor_lock;
+}
+
+// Add or remove one atom in the _NET_WM_STATE property, keeping the other states. Called with the
+// display locked
+static void
+window_state_update(window_t* window, Atom state, bool set) {
+	Atom actual_type;
+	int actual_format;
+	unsigned long items_count = 0, bytes_after;
+	Atom* atoms = 0;
+	XGetWindowProperty(window->display, window->drawable, window_atom_wm_state, 0, 64, False, XA_ATOM,
+	                   &actual_type, &actual_format, &items_count, &bytes_after, (unsigned char**)&atoms);
+
+	Atom updated[65];
+	int count = 0;
+	for (unsigned long iatom = 0; atoms && (iatom < items_count) && (iatom < 64); ++iatom) {
+		if (atoms[iatom] != state)
+			updated[count++] = atoms[iatom];
+	}
+	if (set)
+		updated[count++] = state;
+	if (atoms)
+		XFree(atoms);
+
+	XChangeProperty(window->display, window->drawable, window_atom_wm_state, XA_ATOM, 32, PropModeReplace,
+	                (unsigned char*)updated, count);
+}
+
+void
+window_set_fullscreen(window_t* window, bool fullscreen, unsigned int monitor) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_set_fullscreen(window, fullscreen);
+		return;
+	}
+#endif
+	// Child windows follow their parent
+	if (!window->created || !window->atom_delete)
+		return;
+
+	window_monitor_t target;
+	unsigned int head = 0;
+	bool targeted = fullscreen && (monitor != WINDOW_MONITOR_CURRENT) && window_monitor_head(monitor, &target, &head);
+
+	window_lock_display(window->display);
+
+	Window root = XRootWindow(window->display, (int)window->screen);
+	long mask = SubstructureRedirectMask | SubstructureNotifyMask;
+	XEvent event;
+
+	if (targeted) {
+		// Moving first makes window managers without _NET_WM_FULLSCREEN_MONITORS pick the target
+		// monitor as the one containing the window
+		XMoveWindow(window->display, window->drawable, target.x, target.y);
+
+		memset(&event, 0, sizeof(event));
+		event.type = ClientMessage;
+		event.xclient.window = window->drawable;
+		event.xclient.message_type = window_atom_fullscreen_monitors;
+		event.xclient.format = 32;
+		event.xclient.data.l[0] = (long)head;
+		event.xclient.data.l[1] = (long)head;
+		event.xclient.data.l[2] = (long)head;
+		event.xclient.data.l[3] = (long)head;
+		event.xclient.data.l[4] = 1;
+		XSendEvent(window->display, root, False, mask, &event);
+	}
+
+	// Set before the state change so the compositor can unredirect on the first fullscreen frame
+	window_bypass_compositor(window, fullscreen);
+
+	if (window->mapped) {
+		memset(&event, 0, sizeof(event));
+		event.type = ClientMessage;
+		event.xclient.window = window->drawable;
+		event.xclient.message_type = window_atom_wm_state;
+		event.xclient.format = 32;
+		event.xclient.data.l[0] = fullscreen ? _NET_WM_STATE_ADD : _NET_WM_STATE_REMOVE;
+		event.xclient.data.l[1] = (long)window_atom_fullscreen;
+		event.xclient.data.l[3] = 1;
+		XSendEvent(window->display, root, False, mask, &event);
+	} else {
+		// Window manager owns the state of mapped windows, unmapped windows carry it as a property
+		window_state_update(window, window_atom_fullscreen, fullscreen);
+	}
+	window->fullscreen = fullscreen;
+
+	// No round trip, the window manager reports the new geometry as a configure notification
+	XFlush(window->display);
+	window_unlock_display(window->display);
+}
+
+void
+window_frame_complete(window_t* window) {
+	// Only set on create, no lock needed for windows without a counter
+	if (window->wayland || !window->sync_counter)
+		return;
+	window_lock_display(window->display);
+	if (window->sync_pending) {
+		window_sync_set_counter(window, window->sync_value);
+		window->sync_pending = false;
+		XFlush(window->display);
+	}
+	window_unlock_display(window->display);
+}
+
+bool
+window_is_fullscreen(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return window_wayland_is_fullscreen(window);
+	}
+#endif
+	return window->fullscreen;
 }
 
 void
 window_set_title(window_t* window, const char* title, size_t length) {
-	FOUNDATION_UNUSED(window);
-	FOUNDATION_UNUSED(title);
-	FOUNDATION_UNUSED(length);
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		window_wayland_set_title(window, title, length);
+		return;
+	}
+#endif
+	// Child windows have no title
+	if (!window->created || !window->atom_delete)
+		return;
+	// Truncate on a UTF-8 character boundary
+	if (length >= WINDOW_TITLE_CAPACITY) {
+		length = WINDOW_TITLE_CAPACITY - 1;
+		while (length && ((title[length] & 0xC0) == 0x80))
+			--length;
+	}
+	mutex_lock(window_title_mutex);
+	// Kept out of the window structure, most windows never change title
+	if (!window->title_buffer)
+		window->title_buffer = memory_allocate(HASH_WINDOW, WINDOW_TITLE_CAPACITY, 0, MEMORY_PERSISTENT);
+	memcpy(window->title_buffer, title, length);
+	window->title_length = length;
+	atomic_store32(&window->title_dirty, 1, memory_order_release);
+	mutex_unlock(window_title_mutex);
+	// Only the first update since the loop last wrote titles needs to wake it
+	if (atomic_cas32(&window_title_pending, 1, 0, memory_order_release, memory_order_relaxed))
+		window_loop_wake();
 }
 
 unsigned int
 window_width(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return (unsigned int)window->width;
+	}
+#endif
 	Window root;
 	int x, y;
 	unsigned int width = 0, height, border, depth;
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_WIDTH);
+	window_lock_display(window->display);
 	if (XGetGeometry(window->display, window->drawable, &root, &x, &y, &width, &height, &border, &depth) == 0)
 		width = 0;
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_WIDTH, 1);
+	window_unlock_display(window->display);
 	return width;
 }
 
 unsigned int
 window_height(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return (unsigned int)window->height;
+	}
+#endif
 	Window root;
 	int x, y;
 	unsigned int width, height = 0, border, depth;
-	XLockDisplay(window->display);
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_HEIGHT);
+	window_lock_display(window->display);
 	if (XGetGeometry(window->display, window->drawable, &root, &x, &y, &width, &height, &border, &depth) == 0)
 		height = 0;
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_HEIGHT, 1);
+	window_unlock_display(window->display);
 	return height;
 }
 
 int
 window_position_x(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return 0;
+	}
+#endif
 	Window child;
 	int x, y;
-	XLockDisplay(window->display);
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_POSITION_X);
+	window_lock_display(window->display);
 	Window root = XRootWindow(window->display, (int)window->screen);
 	XTranslateCoordinates(window->display, window->drawable, root, 0, 0, &x, &y, &child);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_POSITION_X, 1);
+	window_unlock_display(window->display);
 	return x;
 }
 
 int
 window_position_y(window_t* window) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window->wayland) {
+		return 0;
+	}
+#endif
 	Window child;
 	int x, y;
-	XLockDisplay(window->display);
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_POSITION_Y);
+	window_lock_display(window->display);
 	Window root = XRootWindow(window->display, (int)window->screen);
 	XTranslateCoordinates(window->display, window->drawable, root, 0, 0, &x, &y, &child);
-	XUnlockDisplay(window->display);
+	WINDOW_STATS_ROUNDTRIP(WINDOW_STATS_CALL_POSITION_Y, 1);
+	window_unlock_display(window->display);
 	return y;
 }
 
 void
 window_fit_to_screen(window_t* window) {
-	FOUNDATION_UNUSED(window);
+	if (window->wayland || !window->drawable)
+		return;
+	window_monitor_t monitors[WINDOW_MONITOR_LIMIT];
+	size_t count = window_monitors(monitors, WINDOW_MONITOR_LIMIT);
+	if (!count)
+		return;
+	if (count > WINDOW_MONITOR_LIMIT)
+		count = WINDOW_MONITOR_LIMIT;
+
+	Window root, child;
+	int x, y;
+	unsigned int width, height, border, depth;
+	window_lock_display(window->display);
+	if (!XGetGeometry(window->display, window->drawable, &root, &x, &y, &width, &height, &border, &depth) ||
+	    !width || !height) {
+		window_unlock_display(window->display);
+		return;
+	}
+	XTranslateCoordinates(window->display, window->drawable, root, 0, 0, &x, &y, &child);
+
+	// Monitor containing the window center, or else the primary monitor
+	int center_x = x + (int)(width / 2);
+	int center_y = y + (int)(height / 2);
+	const window_monitor_t* monitor = 0;
+	for (size_t imon = 0; imon < count; ++imon) {
+		const window_monitor_t* candidate = monitors + imon;
+		if ((center_x >= candidate->x) && (center_x < candidate->x + (int)candidate->width) &&
+		    (center_y >= candidate->y) && (center_y < candidate->y + (int)candidate->height))
+			monitor = candidate;
+		else if (!monitor && candidate->primary)
+			monitor = candidate;
+	}
+	if (!monitor)
+		monitor = monitors;
+
+	// Shrink keeping the aspect ratio, then move inside the monitor
+	real width_factor = (real)monitor->width / (real)width;
+	real height_factor = (real)monitor->height / (real)height;
+	real factor = (width_factor < height_factor) ? width_factor : height_factor;
+	if (factor < 1) {
+		width = (unsigned int)((real)width * factor);
+		height = (unsigned int)((real)height * factor);
+	}
+	if (x + (int)width > monitor->x + (int)monitor->width)
+		x = monitor->x + (int)monitor->width - (int)width;
+	if (y + (int)height > monitor->y + (int)monitor->height)
+		y = monitor->y + (int)monitor->height - (int)height;
+	if (x < monitor->x)
+		x = monitor->x;
+	if (y < monitor->y)
+		y = monitor->y;
+
+	XMoveResizeWindow(window->display, window->drawable, x, y, width ? width : 1, height ? height : 1);
+	XFlush(window->display);
+	window_unlock_display(window->display);
 }
 
 static bool window_exit_loop;
@@ -530,6 +2415,14 @@ static bool window_exit_loop;
 
 int
 window_message_loop(void) {
+	window_event_defer_block();
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland) {
+		int result = window_wayland_message_loop();
+		window_event_defer_end();
+		return result;
+	}
+#endif
 	window_exit_loop = false;
 	while (window_default_display && !window_exit_loop) {
 		int fd = ConnectionNumber(window_default_display);
@@ -537,86 +2430,202 @@ window_message_loop(void) {
 		fd_set fdset;
 		FD_ZERO(&fdset);
 		FD_SET(fd, &fdset);
+		int max_fd = fd;
+		if (window_wake_fd >= 0) {
+			FD_SET(window_wake_fd, &fdset);
+			max_fd = (window_wake_fd > fd) ? window_wake_fd : fd;
+		}
 
-		int res = select(fd + 1, &fdset, 0, 0, 0);
+		int res = select(max_fd + 1, &fdset, 0, 0, 0);
 		if (res > 0) {
-			XLockDisplay(window_default_display);
-			mutex_lock(window_mutex);
+			if ((window_wake_fd >= 0) && FD_ISSET(window_wake_fd, &fdset)) {
+				uint64_t count;
+				ssize_t wake = read(window_wake_fd, &count, sizeof(count));
+				FOUNDATION_UNUSED(wake);
+			}
+#if WINDOW_ENABLE_STATISTICS
+			tick_t process_start = time_current();
+			unsigned int process_count = 0;
+#endif
+			window_lock_display(window_default_display);
 			while (XPending(window_default_display)) {
 				XEvent event;
 				XNextEvent(window_default_display, &event);
+#if WINDOW_ENABLE_STATISTICS
+				++process_count;
+#endif
 
-				for (size_t iwin = 0, wsize = array_size(window_list); iwin < wsize; ++iwin) {
-					window_t* window = window_list[iwin];
-					if (True == XFilterEvent(&event, window->drawable))
-						continue;
+				if (True == XFilterEvent(&event, None))
+					continue;
 
-					window_event_post_native(WINDOWEVENT_NATIVE, window, &event);
+				if (window_keymap_event(&event))
+					continue;
 
-					XVisibilityEvent* visibility;
-					switch (event.type) {
-						case ClientMessage:
-							if (event.xclient.data.l[0] == (long)window->atom_delete)
-								window_event_post(WINDOWEVENT_CLOSE, window);
-							break;
+				if (window_monitor_event(&event))
+					continue;
 
-						case ConfigureNotify:
-							if (window->last_resize != window_event_token) {
-								window_event_post(WINDOWEVENT_RESIZE, window);
-								window->last_resize = window_event_token;
-							}
+#if WINDOW_ENABLE_XINPUT2
+				if (window_xinput_event(&event))
+					continue;
+#endif
+
+				// Route by event window instead of scanning all windows for every event
+				window_t* window = 0;
+				if (XFindContext(window_default_display, event.xany.window, window_context, (XPointer*)&window) ||
+				    !window)
+					continue;
+
+				// Motion is compressed and posted when a different event arrives or the queue is drained
+				if (event.type == MotionNotify) {
+					window_pointer_motion(window, &event);
+					continue;
+				}
+				window_pointer_flush();
+
+				window_event_post_native(WINDOWEVENT_NATIVE, window, &event);
+
+				XVisibilityEvent* visibility;
+				switch (event.type) {
+					case ClientMessage:
+						if (window->atom_delete && (event.xclient.data.l[0] == (long)window->atom_delete)) {
+							window_event_post(WINDOWEVENT_CLOSE, window);
+						} else if (window->sync_counter &&
+						           (event.xclient.message_type == window_atom_protocols) &&
+						           (event.xclient.data.l[0] == (long)window_atom_sync_request)) {
+							// Value for the counter once the frame for the following configure is drawn
+							uint64_t low = (uint32_t)event.xclient.data.l[2];
+							uint64_t high = (uint32_t)event.xclient.data.l[3];
+							window->sync_request = low | (high << 32ULL);
+							window->sync_requested = true;
+						}
+						break;
+
+					case ConfigureNotify:
+						// Frames drawn from now on have the requested size, window_frame_complete acknowledges
+						// the latest request
+						if (window->sync_requested) {
+							window->sync_value = window->sync_request;
+							window->sync_requested = false;
+							window->sync_pending = true;
+						}
+						if (window->last_resize != window_event_token) {
+							window_event_post(WINDOWEVENT_RESIZE, window);
+							window->last_resize = window_event_token;
+						}
+						if (window->last_paint != window_event_token) {
+							window_event_post(WINDOWEVENT_REDRAW, window);
+							window->last_paint = window_event_token;
+						}
+						break;
+
+					case MapNotify:
+						if (window->input_context_pending) {
+							window_create_input_context(window, WINDOW_STATS_CALL_CREATE);
+							window->input_context_pending = false;
+						}
+						if (window->create_pending) {
+							// Asynchronously created window is now on screen
+							window->create_pending = false;
+							window_event_post(WINDOWEVENT_CREATE, window);
+						}
+						if (!window->mapped) {
+							window_event_post(WINDOWEVENT_SHOW, window);
 							if (window->last_paint != window_event_token) {
 								window_event_post(WINDOWEVENT_REDRAW, window);
 								window->last_paint = window_event_token;
 							}
-							break;
-
-						case VisibilityNotify:
-							visibility = (XVisibilityEvent*)&event;
-							if (visibility->state == VisibilityFullyObscured) {
-								if (window->visible)
-									window_event_post(WINDOWEVENT_HIDE, window);
-								window->visible = false;
-							} else {
-								if (!window->visible) {
-									window_event_post(WINDOWEVENT_SHOW, window);
-									if (window->last_paint != window_event_token) {
-										window_event_post(WINDOWEVENT_REDRAW, window);
-										window->last_paint = window_event_token;
-									}
-								}
-								window->visible = true;
-							}
-							break;
-
-						case FocusIn:
-							if (!window->focus)
-								window_event_post(WINDOWEVENT_GOTFOCUS, window);
-							window->focus = true;
-							break;
-
-						case FocusOut:
-							if (window->focus)
-								window_event_post(WINDOWEVENT_LOSTFOCUS, window);
-							window->focus = false;
-							break;
-					}
+						}
+						window->mapped = true;
+						window->visible = true;
+						break;
+
+					case UnmapNotify:
+						if (window->mapped)
+							window_event_post(WINDOWEVENT_HIDE, window);
+						window->mapped = false;
+						window->visible = false;
+						break;
+
+					case VisibilityNotify:
+						// Obscured windows stay shown, SHOW and HIDE follow the map state
+						visibility = (XVisibilityEvent*)&event;
+						window->visible = window->mapped && (visibility->state != VisibilityFullyObscured);
+						break;
+
+					case KeyPress:
+					case KeyRelease:
+						window_key_event(window, &event.xkey);
+						break;
+
+					case ButtonPress:
+					case ButtonRelease:
+						window_pointer_button(window, &event.xbutton);
+						break;
+
+					case FocusIn:
+						if (!window->focus)
+							window_event_post(WINDOWEVENT_GOTFOCUS, window);
+						window->focus = true;
+						if (window->cursor_lock && !window->cursor_grabbed)
+							window_cursor_grab(window);
+						break;
+
+					case FocusOut:
+						// Releases go to the new focus window, do not report the next press as a repeat
+						memset(window_key_held, 0, sizeof(window_key_held));
+						memset(window->input_live.keys, 0, sizeof(window->input_live.keys));
+						window->input_live.buttons = 0;
+						window_input_changed(window);
+						if (window->focus)
+							window_event_post(WINDOWEVENT_LOSTFOCUS, window);
+						window->focus = false;
+						// Do not hold the pointer while another window has focus, grabbed again on focus in
+						if (window->cursor_grabbed)
+							XUngrabPointer(window->display, CurrentTime);
+						window->cursor_grabbed = false;
+						break;
 				}
 			}
+			window_pointer_flush();
+#if WINDOW_ENABLE_XINPUT2
+			window_xinput_raw_flush();
+#endif
+			window_input_publish_pending();
+			if (window_monitor_dirty) {
+				window_monitor_dirty = false;
+				window_monitor_refresh(window_default_display);
+				window_event_post(WINDOWEVENT_MONITORS_CHANGED, nullptr);
+			}
+			window_title_flush(window_default_display);
+
+			window_unlock_display(window_default_display);
+
+			window_event_dispatch_deferred();
+			window_event_backpressure();
 
-			mutex_unlock(window_mutex);
-			XUnlockDisplay(window_default_display);
+			WINDOW_STATS_LOOP(process_count, process_start);
+
+			// RESIZE and REDRAW are coalesced per loop wake-up
+			++window_event_token;
 		}
 	}
+	window_event_defer_end();
 	return 0;
 }
 
 void
 window_message_quit(void) {
+#if WINDOW_ENABLE_WAYLAND
+	if (window_use_wayland) {
+		window_wayland_message_quit();
+		return;
+	}
+#endif
+	WINDOW_STATS_CALL(WINDOW_STATS_CALL_MESSAGE_QUIT);
 	if (window_default_display) {
 		window_exit_loop = true;
 
-		XLockDisplay(window_default_display);
+		window_lock_display(window_default_display);
 		XClientMessageEvent event;
 		memset(&event, 0, sizeof(event));
 		event.type = ClientMessage;
@@ -624,7 +2633,7 @@ window_message_quit(void) {
 			event.window = window_list[0]->drawable;
 		event.format = 32;
 		XSendEvent(window_default_display, event.window, False, 0, (XEvent*)&event);
-		XUnlockDisplay(window_default_display);
+		window_unlock_display(window_default_display);
 	}
 }
 
@@ -26,7 +26,8 @@ static semaphore_t window_quit_semaphore;
 static bool window_exit_loop;
 
 void
-window_native_initialize(void) {
+window_native_initialize(const window_config_t* config) {
+	FOUNDATION_UNUSED(config);
 	semaphore_initialize(&window_quit_semaphore, 0);
 	window_exit_loop = 0;
 }
@@ -80,7 +81,7 @@ window_native_finalize(void) {
 
 window_t*
 window_allocate(void* nswindow) {
-	window_t* window = memory_allocate(0, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	window_t* window = window_pool_allocate();
 	window_initialize(window, nswindow);
 	return window;
 }
@@ -92,6 +93,7 @@ window_initialize(window_t* window, void* nswindow) {
 	WindowDelegate* delegate = [[WindowDelegate alloc] init];
 	delegate.window = window;
 	window->delegate = (__bridge_retained void*)delegate;
+	window_handle_acquire(window);
 	if (window->nswindow) {
 		dispatch_sync(dispatch_get_main_queue(), ^{
 		  [(__bridge NSWindow*)window->nswindow setDelegate:delegate];
@@ -112,12 +114,13 @@ window_finalize(window_t* window) {
 		CFRelease(window->delegate);
 	window->delegate = nullptr;
 	window->nswindow = nullptr;
+	window_handle_release(window);
 }
 
 void
 window_deallocate(window_t* window) {
 	window_finalize(window);
-	memory_deallocate(window);
+	window_pool_deallocate(window);
 }
 
 void*
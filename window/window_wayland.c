@@ -0,0 +1,792 @@
+/* window_wayland.c  -  Window library  -  Public Domain  -  2014 Mattias Jansson
+ *
+ * This library provides a cross-platform window library in C11 providing basic support data types
+ * and functions to create and manage windows in a platform-independent fashion. The latest source
+ * code is always available at
+ *
+ * https://github.com/mjansson/window_lib
+ *
+ * This library is put in the public domain; you can redistribute it and/or modify it without any
+ * restrictions.
+ *
+ */
+
+#include <window/window.h>
+#include <window/internal.h>
+
+#if FOUNDATION_PLATFORM_LINUX && WINDOW_ENABLE_WAYLAND
+
+#include <foundation/foundation.h>
+
+#include <wayland-client.h>
+
+#include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Subset of the xdg-shell protocol used by the backend, declared here rather than generated
+// by wayland-scanner so the backend only depends on wayland-client being installed
+
+#define XDG_WM_BASE_DESTROY 0
+#define XDG_WM_BASE_GET_XDG_SURFACE 2
+#define XDG_WM_BASE_PONG 3
+
+#define XDG_SURFACE_DESTROY 0
+#define XDG_SURFACE_GET_TOPLEVEL 1
+#define XDG_SURFACE_ACK_CONFIGURE 4
+
+#define XDG_TOPLEVEL_DESTROY 0
+#define XDG_TOPLEVEL_SET_TITLE 2
+#define XDG_TOPLEVEL_SET_APP_ID 3
+#define XDG_TOPLEVEL_SET_MAX_SIZE 7
+#define XDG_TOPLEVEL_SET_MIN_SIZE 8
+#define XDG_TOPLEVEL_SET_MAXIMIZED 9
+#define XDG_TOPLEVEL_UNSET_MAXIMIZED 10
+#define XDG_TOPLEVEL_SET_FULLSCREEN 11
+#define XDG_TOPLEVEL_UNSET_FULLSCREEN 12
+#define XDG_TOPLEVEL_SET_MINIMIZED 13
+
+#define XDG_TOPLEVEL_STATE_MAXIMIZED 1
+#define XDG_TOPLEVEL_STATE_FULLSCREEN 2
+#define XDG_TOPLEVEL_STATE_RESIZING 3
+#define XDG_TOPLEVEL_STATE_ACTIVATED 4
+
+static const struct wl_interface window_xdg_surface_interface;
+static const struct wl_interface window_xdg_toplevel_interface;
+
+static const struct wl_interface window_xdg_positioner_interface = {"xdg_positioner", 1, 0, nullptr, 0, nullptr};
+static const struct wl_interface window_xdg_popup_interface = {"xdg_popup", 1, 0, nullptr, 0, nullptr};
+
+static const struct wl_interface* window_xdg_types[] = {nullptr,
+                                                       nullptr,
+                                                       nullptr,
+                                                       nullptr,
+                                                       &window_xdg_positioner_interface,
+                                                       &window_xdg_surface_interface,
+                                                       &wl_surface_interface,
+                                                       &window_xdg_toplevel_interface,
+                                                       &window_xdg_popup_interface,
+                                                       &window_xdg_surface_interface,
+                                                       &window_xdg_positioner_interface,
+                                                       &window_xdg_toplevel_interface,
+                                                       &wl_seat_interface,
+                                                       nullptr,
+                                                       nullptr,
+                                                       nullptr,
+                                                       &wl_seat_interface,
+                                                       nullptr,
+                                                       &wl_seat_interface,
+                                                       nullptr,
+                                                       nullptr,
+                                                       &wl_output_interface};
+
+static const struct wl_message window_xdg_wm_base_requests[] = {{"destroy", "", window_xdg_types + 0},
+                                                                {"create_positioner", "n", window_xdg_types + 4},
+                                                                {"get_xdg_surface", "no", window_xdg_types + 5},
+                                                                {"pong", "u", window_xdg_types + 0}};
+
+static const struct wl_message window_xdg_wm_base_events[] = {{"ping", "u", window_xdg_types + 0}};
+
+static const struct wl_interface window_xdg_wm_base_interface = {"xdg_wm_base", 1, 4, window_xdg_wm_base_requests,
+                                                                 1, window_xdg_wm_base_events};
+
+static const struct wl_message window_xdg_surface_requests[] = {{"destroy", "", window_xdg_types + 0},
+                                                                {"get_toplevel", "n", window_xdg_types + 7},
+                                                                {"get_popup", "n?oo", window_xdg_types + 8},
+                                                                {"set_window_geometry", "iiii", window_xdg_types + 0},
+                                                                {"ack_configure", "u", window_xdg_types + 0}};
+
+static const struct wl_message window_xdg_surface_events[] = {{"configure", "u", window_xdg_types + 0}};
+
+static const struct wl_interface window_xdg_surface_interface = {"xdg_surface", 1, 5, window_xdg_surface_requests,
+                                                                 1, window_xdg_surface_events};
+
+static const struct wl_message window_xdg_toplevel_requests[] = {{"destroy", "", window_xdg_types + 0},
+                                                                 {"set_parent", "?o", window_xdg_types + 11},
+                                                                 {"set_title", "s", window_xdg_types + 0},
+                                                                 {"set_app_id", "s", window_xdg_types + 0},
+                                                                 {"show_window_menu", "ouii", window_xdg_types + 12},
+                                                                 {"move", "ou", window_xdg_types + 16},
+                                                                 {"resize", "ouu", window_xdg_types + 18},
+                                                                 {"set_max_size", "ii", window_xdg_types + 0},
+                                                                 {"set_min_size", "ii", window_xdg_types + 0},
+                                                                 {"set_maximized", "", window_xdg_types + 0},
+                                                                 {"unset_maximized", "", window_xdg_types + 0},
+                                                                 {"set_fullscreen", "?o", window_xdg_types + 21},
+                                                                 {"unset_fullscreen", "", window_xdg_types + 0},
+                                                                 {"set_minimized", "", window_xdg_types + 0}};
+
+static const struct wl_message window_xdg_toplevel_events[] = {{"configure", "iia", window_xdg_types + 0},
+                                                               {"close", "", window_xdg_types + 0}};
+
+static const struct wl_interface window_xdg_toplevel_interface = {"xdg_toplevel", 1, 14, window_xdg_toplevel_requests,
+                                                                  2, window_xdg_toplevel_events};
+
+struct window_xdg_wm_base_listener {
+	void (*ping)(void* data, struct wl_proxy* wm_base, uint32_t serial);
+};
+
+struct window_xdg_surface_listener {
+	void (*configure)(void* data, struct wl_proxy* xdg_surface, uint32_t serial);
+};
+
+struct window_xdg_toplevel_listener {
+	void (*configure)(void* data, struct wl_proxy* xdg_toplevel, int32_t width, int32_t height, struct wl_array* states);
+	void (*close)(void* data, struct wl_proxy* xdg_toplevel);
+};
+
+static struct wl_display* wayland_display;
+static struct wl_registry* wayland_registry;
+static struct wl_compositor* wayland_compositor;
+static struct wl_shm* wayland_shm;
+static struct wl_proxy* wayland_wm_base;
+
+// Outputs are identified by their registry name, which stays valid when the array is reallocated
+typedef struct wayland_output_t {
+	struct wl_output* output;
+	uint32_t name;
+	int32_t scale;
+	window_monitor_t monitor;
+} wayland_output_t;
+
+static wayland_output_t* wayland_output_list;
+static bool wayland_output_ready;
+
+// Guards the window and output lists and the state written by listeners, the message loop holds it
+// while dispatching so proxies are not destroyed by another thread during their callbacks
+static window_t** wayland_window_list;
+static mutex_t* wayland_mutex;
+
+static int wayland_wake[2] = {-1, -1};
+static bool wayland_exit_loop;
+
+static void
+wayland_wm_base_ping(void* data, struct wl_proxy* wm_base, uint32_t serial) {
+	FOUNDATION_UNUSED(data);
+	wl_proxy_marshal(wm_base, XDG_WM_BASE_PONG, serial);
+}
+
+static const struct window_xdg_wm_base_listener wayland_wm_base_listener = {wayland_wm_base_ping};
+
+static wayland_output_t*
+wayland_output_find(void* data) {
+	uint32_t name = (uint32_t)(uintptr_t)data;
+	for (size_t iout = 0, osize = array_size(wayland_output_list); iout < osize; ++iout) {
+		if (wayland_output_list[iout].name == name)
+			return wayland_output_list + iout;
+	}
+	return nullptr;
+}
+
+static void
+wayland_output_geometry(void* data, struct wl_output* output, int32_t x, int32_t y, int32_t physical_width,
+                        int32_t physical_height, int32_t subpixel, const char* make, const char* model,
+                        int32_t transform) {
+	FOUNDATION_UNUSED(output);
+	FOUNDATION_UNUSED(subpixel);
+	FOUNDATION_UNUSED(make);
+	FOUNDATION_UNUSED(transform);
+	wayland_output_t* entry = wayland_output_find(data);
+	if (!entry)
+		return;
+	entry->monitor.x = x;
+	entry->monitor.y = y;
+	entry->monitor.width_mm = (physical_width > 0) ? (uint32_t)physical_width : 0;
+	entry->monitor.height_mm = (physical_height > 0) ? (uint32_t)physical_height : 0;
+	string_copy(entry->monitor.name, sizeof(entry->monitor.name), model, string_length(model));
+}
+
+static void
+wayland_output_mode(void* data, struct wl_output* output, uint32_t flags, int32_t width, int32_t height,
+                    int32_t refresh) {
+	FOUNDATION_UNUSED(output);
+	wayland_output_t* entry = wayland_output_find(data);
+	if (!entry || !(flags & WL_OUTPUT_MODE_CURRENT))
+		return;
+	entry->monitor.width = (uint32_t)width;
+	entry->monitor.height = (uint32_t)height;
+	entry->monitor.refresh_rate = (float)refresh / 1000.0f;
+}
+
+static void
+wayland_output_done(void* data, struct wl_output* output) {
+	FOUNDATION_UNUSED(output);
+	wayland_output_t* entry = wayland_output_find(data);
+	if (!entry)
+		return;
+	window_monitor_t* monitor = &entry->monitor;
+	monitor->dpi = 96.0f;
+	if ((monitor->width_mm >= 20) && monitor->width)
+		monitor->dpi = ((float)monitor->width * 25.4f) / (float)monitor->width_mm;
+	// The compositor scale is what it expects buffers to be rendered at
+	monitor->scale = (entry->scale > 1) ? (float)entry->scale : 1.0f;
+	if (wayland_output_ready)
+		window_event_post(WINDOWEVENT_MONITORS_CHANGED, nullptr);
+}
+
+static void
+wayland_output_scale(void* data, struct wl_output* output, int32_t factor) {
+	FOUNDATION_UNUSED(output);
+	wayland_output_t* entry = wayland_output_find(data);
+	if (entry)
+		entry->scale = factor;
+}
+
+// Connector name like the RandR output name, replaces the model name from version 4
+static void
+wayland_output_name(void* data, struct wl_output* output, const char* name) {
+	FOUNDATION_UNUSED(output);
+	wayland_output_t* entry = wayland_output_find(data);
+	if (entry)
+		string_copy(entry->monitor.name, sizeof(entry->monitor.name), name, string_length(name));
+}
+
+static void
+wayland_output_description(void* data, struct wl_output* output, const char* description) {
+	FOUNDATION_UNUSED(data);
+	FOUNDATION_UNUSED(output);
+	FOUNDATION_UNUSED(description);
+}
+
+static const struct wl_output_listener wayland_output_listener = {
+    wayland_output_geometry, wayland_output_mode, wayland_output_done,
+    wayland_output_scale,    wayland_output_name, wayland_output_description};
+
+static void
+wayland_registry_global(void* data, struct wl_registry* registry, uint32_t name, const char* interface,
+                        uint32_t version) {
+	FOUNDATION_UNUSED(data);
+	size_t length = string_length(interface);
+	if (string_equal(interface, length, STRING_CONST("wl_compositor"))) {
+		wayland_compositor = wl_registry_bind(registry, name, &wl_compositor_interface, (version < 3) ? version : 3);
+	} else if (string_equal(interface, length, STRING_CONST("wl_shm"))) {
+		wayland_shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (string_equal(interface, length, STRING_CONST("xdg_wm_base"))) {
+		wayland_wm_base = wl_registry_bind(registry, name, &window_xdg_wm_base_interface, 1);
+		wl_proxy_add_listener(wayland_wm_base, (void (**)(void))&wayland_wm_base_listener, 0);
+	} else if (string_equal(interface, length, STRING_CONST("wl_output"))) {
+		wayland_output_t entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.output = wl_registry_bind(registry, name, &wl_output_interface, (version < 4) ? version : 4);
+		entry.name = name;
+		entry.monitor.id = name;
+		entry.monitor.dpi = 96.0f;
+		entry.monitor.scale = 1.0f;
+		array_push(wayland_output_list, entry);
+		wl_output_add_listener(entry.output, &wayland_output_listener, (void*)(uintptr_t)name);
+	}
+}
+
+static void
+wayland_registry_global_remove(void* data, struct wl_registry* registry, uint32_t name) {
+	FOUNDATION_UNUSED(data);
+	FOUNDATION_UNUSED(registry);
+	wayland_output_t* entry = wayland_output_find((void*)(uintptr_t)name);
+	if (!entry)
+		return;
+	wl_output_destroy(entry->output);
+	array_erase(wayland_output_list, (size_t)(entry - wayland_output_list));
+	window_event_post(WINDOWEVENT_MONITORS_CHANGED, nullptr);
+}
+
+static const struct wl_registry_listener wayland_registry_listener = {wayland_registry_global,
+                                                                      wayland_registry_global_remove};
+
+bool
+window_wayland_initialize(size_t capacity) {
+	string_const_t backend = environment_variable(STRING_CONST("WINDOW_BACKEND"));
+	if (string_equal(STRING_ARGS(backend), STRING_CONST("x11")))
+		return false;
+	bool forced = string_equal(STRING_ARGS(backend), STRING_CONST("wayland"));
+	if (!forced && !environment_variable(STRING_CONST("WAYLAND_DISPLAY")).length)
+		return false;
+
+	wayland_display = wl_display_connect(0);
+	if (!wayland_display) {
+		if (forced)
+			log_warn(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Unable to connect to Wayland display"));
+		return false;
+	}
+
+	wayland_registry = wl_display_get_registry(wayland_display);
+	wl_registry_add_listener(wayland_registry, &wayland_registry_listener, 0);
+	wl_display_roundtrip(wayland_display);
+	// Second round trip delivers the geometry and modes of the outputs bound by the first
+	wl_display_roundtrip(wayland_display);
+	wayland_output_ready = true;
+
+	if (!wayland_compositor || !wayland_shm || !wayland_wm_base) {
+		log_warn(HASH_WINDOW, WARNING_UNSUPPORTED,
+		         STRING_CONST("Wayland compositor lacks wl_compositor, wl_shm or xdg_wm_base, using X11"));
+		window_wayland_finalize();
+		return false;
+	}
+
+	if (pipe2(wayland_wake, O_CLOEXEC | O_NONBLOCK) < 0) {
+		log_warn(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Unable to create Wayland loop wake pipe"));
+		window_wayland_finalize();
+		return false;
+	}
+
+	wayland_mutex = mutex_allocate(STRING_CONST("wayland_window_list"));
+	wayland_window_list = 0;
+	array_reserve(wayland_window_list, capacity);
+
+	log_debug(HASH_WINDOW, STRING_CONST("Using native Wayland backend"));
+	return true;
+}
+
+void
+window_wayland_finalize(void) {
+	for (size_t iout = 0, osize = array_size(wayland_output_list); iout < osize; ++iout)
+		wl_output_destroy(wayland_output_list[iout].output);
+	array_deallocate(wayland_output_list);
+	wayland_output_ready = false;
+	if (wayland_wm_base) {
+		wl_proxy_marshal(wayland_wm_base, XDG_WM_BASE_DESTROY);
+		wl_proxy_destroy(wayland_wm_base);
+	}
+	if (wayland_shm)
+		wl_shm_destroy(wayland_shm);
+	if (wayland_compositor)
+		wl_compositor_destroy(wayland_compositor);
+	if (wayland_registry)
+		wl_registry_destroy(wayland_registry);
+	if (wayland_display)
+		wl_display_disconnect(wayland_display);
+	if (wayland_wake[0] >= 0) {
+		close(wayland_wake[0]);
+		close(wayland_wake[1]);
+	}
+	if (wayland_mutex)
+		mutex_deallocate(wayland_mutex);
+	array_deallocate(wayland_window_list);
+
+	wayland_wm_base = 0;
+	wayland_shm = 0;
+	wayland_compositor = 0;
+	wayland_registry = 0;
+	wayland_display = 0;
+	wayland_wake[0] = wayland_wake[1] = -1;
+	wayland_mutex = 0;
+}
+
+static void
+window_wayland_buffer_release(window_t* window) {
+	if (window->wl_buffer)
+		wl_buffer_destroy(window->wl_buffer);
+	if (window->shm_data)
+		munmap(window->shm_data, window->shm_size);
+	window->wl_buffer = 0;
+	window->shm_data = 0;
+	window->shm_size = 0;
+}
+
+static bool
+window_wayland_buffer_allocate(window_t* window, int width, int height) {
+	window_wayland_buffer_release(window);
+
+	int stride = width * 4;
+	size_t size = (size_t)stride * (size_t)height;
+	int fd = memfd_create("window_shm", MFD_CLOEXEC);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, (off_t)size) < 0) {
+		close(fd);
+		return false;
+	}
+	// Fresh memfd pages are zero, which is opaque black in XRGB8888
+	void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	struct wl_shm_pool* pool = wl_shm_create_pool(wayland_shm, fd, (int32_t)size);
+	window->wl_buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	window->shm_data = data;
+	window->shm_size = size;
+	window->width = width;
+	window->height = height;
+	return true;
+}
+
+static void
+window_wayland_frame_done(void* data, struct wl_callback* callback, uint32_t time);
+
+static const struct wl_callback_listener window_wayland_frame_listener = {window_wayland_frame_done};
+
+// The frame request is double buffered surface state, applied by the next commit of either the
+// library or the client rendering to the surface
+static void
+window_wayland_frame_request(window_t* window) {
+	if (!window->wl_frame) {
+		window->wl_frame = wl_surface_frame(window->wl_surface);
+		wl_callback_add_listener(window->wl_frame, &window_wayland_frame_listener, window);
+	}
+}
+
+static void
+window_wayland_commit(window_t* window) {
+	wl_surface_attach(window->wl_surface, window->wl_buffer, 0, 0);
+	wl_surface_damage(window->wl_surface, 0, 0, window->width, window->height);
+	window_wayland_frame_request(window);
+	wl_surface_commit(window->wl_surface);
+}
+
+static void
+window_wayland_frame_done(void* data, struct wl_callback* callback, uint32_t time) {
+	window_t* window = data;
+	FOUNDATION_UNUSED(time);
+	wl_callback_destroy(callback);
+	window->wl_frame = 0;
+	// Compositor is ready for a new frame, paced to its repaint cycle
+	if (window->last_paint != window_event_token) {
+		window_event_post(WINDOWEVENT_REDRAW, window);
+		window->last_paint = window_event_token;
+	}
+}
+
+static void
+window_wayland_xdg_surface_configure(void* data, struct wl_proxy* xdg_surface, uint32_t serial) {
+	window_t* window = data;
+	FOUNDATION_UNUSED(xdg_surface);
+	// Only the last configure in a dispatch batch is acked and applied, see window_wayland_apply_configure
+	window->configure_serial = serial;
+	window->configure_pending = true;
+}
+
+static const struct window_xdg_surface_listener window_wayland_xdg_surface_listener = {
+    window_wayland_xdg_surface_configure};
+
+static void
+window_wayland_xdg_toplevel_configure(void* data, struct wl_proxy* xdg_toplevel, int32_t width, int32_t height,
+                                      struct wl_array* states) {
+	window_t* window = data;
+	FOUNDATION_UNUSED(xdg_toplevel);
+	window->configure_width = width;
+	window->configure_height = height;
+	window->configure_state = 0;
+	uint32_t* state;
+	wl_array_for_each(state, states) {
+		if (*state < 32)
+			window->configure_state |= (1U << *state);
+	}
+}
+
+static void
+window_wayland_xdg_toplevel_close(void* data, struct wl_proxy* xdg_toplevel) {
+	FOUNDATION_UNUSED(xdg_toplevel);
+	window_event_post(WINDOWEVENT_CLOSE, data);
+}
+
+static const struct window_xdg_toplevel_listener window_wayland_xdg_toplevel_listener = {
+    window_wayland_xdg_toplevel_configure, window_wayland_xdg_toplevel_close};
+
+static void
+window_wayland_apply_configure(window_t* window) {
+	if (window->configure_pending) {
+		window->configure_pending = false;
+		wl_proxy_marshal(window->xdg_surface, XDG_SURFACE_ACK_CONFIGURE, window->configure_serial);
+	}
+
+	int width = window->configure_width ? window->configure_width : window->width;
+	int height = window->configure_height ? window->configure_height : window->height;
+	bool resized = (width != window->width) || (height != window->height) || !window->visible;
+	if (window->wl_external) {
+		// The client renders to the surface and commits its own buffers, attaching the placeholder
+		// would replace its frame. The RESIZE event tells it to resize its buffers
+		window_wayland_buffer_release(window);
+		window->width = width;
+		window->height = height;
+		window_wayland_frame_request(window);
+	} else {
+		if (resized || !window->wl_buffer) {
+			if (!window_wayland_buffer_allocate(window, width, height)) {
+				log_warnf(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL,
+				          STRING_CONST("Unable to allocate %dx%d shm buffer"), width, height);
+				return;
+			}
+		}
+		window_wayland_commit(window);
+	}
+
+	if (!window->visible) {
+		window->visible = true;
+		window_event_post(WINDOWEVENT_SHOW, window);
+	}
+	if (resized && (window->last_resize != window_event_token)) {
+		window_event_post(WINDOWEVENT_RESIZE, window);
+		window->last_resize = window_event_token;
+	}
+
+	bool focus = (window->configure_state & (1U << XDG_TOPLEVEL_STATE_ACTIVATED)) != 0;
+	if (focus != window->focus) {
+		window->focus = focus;
+		window_event_post(focus ? WINDOWEVENT_GOTFOCUS : WINDOWEVENT_LOSTFOCUS, window);
+	}
+}
+
+void
+window_wayland_create(window_t* window, const char* title, size_t length, unsigned int width, unsigned int height,
+                      unsigned int flags) {
+	window->wayland = true;
+	window->wl_display = wayland_display;
+	window->wl_external = false;
+	window->width = (int)width;
+	window->height = (int)height;
+	window->flags = flags;
+
+	window->wl_surface = wl_compositor_create_surface(wayland_compositor);
+	window->xdg_surface = wl_proxy_marshal_constructor(wayland_wm_base, XDG_WM_BASE_GET_XDG_SURFACE,
+	                                                   &window_xdg_surface_interface, nullptr, window->wl_surface);
+	wl_proxy_add_listener(window->xdg_surface, (void (**)(void))&window_wayland_xdg_surface_listener, window);
+	window->xdg_toplevel = wl_proxy_marshal_constructor(window->xdg_surface, XDG_SURFACE_GET_TOPLEVEL,
+	                                                    &window_xdg_toplevel_interface, nullptr);
+	wl_proxy_add_listener(window->xdg_toplevel, (void (**)(void))&window_wayland_xdg_toplevel_listener, window);
+
+	window_wayland_set_title(window, title, length);
+	if (flags & WINDOW_FLAG_NORESIZE) {
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_MIN_SIZE, (int32_t)width, (int32_t)height);
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_MAX_SIZE, (int32_t)width, (int32_t)height);
+	}
+	// Set before the initial commit so the first configure already has the fullscreen size
+	if (flags & WINDOW_FLAG_FULLSCREEN)
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_FULLSCREEN, nullptr);
+
+	// Initial commit without a buffer, the compositor replies with the first configure
+	if (!(flags & WINDOW_FLAG_NOSHOW))
+		wl_surface_commit(window->wl_surface);
+	wl_display_flush(wayland_display);
+
+	window->created = true;
+	window_handle_acquire(window);
+
+	mutex_lock(wayland_mutex);
+	array_push(wayland_window_list, window);
+	mutex_unlock(wayland_mutex);
+
+	window_event_post(WINDOWEVENT_CREATE, window);
+}
+
+void
+window_wayland_finalize_window(window_t* window) {
+	// Proxies are destroyed with the list locked, the loop thread cannot be dispatching their events.
+	// Events already queued for a destroyed proxy are discarded by libwayland
+	mutex_lock(wayland_mutex);
+	for (size_t iwin = 0, wsize = array_size(wayland_window_list); iwin < wsize; ++iwin) {
+		if (wayland_window_list[iwin] == window) {
+			array_erase(wayland_window_list, iwin);
+			break;
+		}
+	}
+
+	if (window->wl_frame)
+		wl_callback_destroy(window->wl_frame);
+	if (window->xdg_toplevel) {
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_DESTROY);
+		wl_proxy_destroy(window->xdg_toplevel);
+	}
+	if (window->xdg_surface) {
+		wl_proxy_marshal(window->xdg_surface, XDG_SURFACE_DESTROY);
+		wl_proxy_destroy(window->xdg_surface);
+	}
+	if (window->wl_surface)
+		wl_surface_destroy(window->wl_surface);
+	window_wayland_buffer_release(window);
+
+	window->wl_frame = 0;
+	window->xdg_toplevel = 0;
+	window->xdg_surface = 0;
+	window->wl_surface = 0;
+	window->wl_display = 0;
+	window->wl_external = false;
+	mutex_unlock(wayland_mutex);
+
+	wl_display_flush(wayland_display);
+
+	if (window->created) {
+		window_event_post(WINDOWEVENT_DESTROY, window);
+		window_handle_release(window);
+	}
+	window->created = false;
+}
+
+void
+window_wayland_maximize(window_t* window) {
+	wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_MAXIMIZED);
+	wl_display_flush(wayland_display);
+}
+
+void
+window_wayland_minimize(window_t* window) {
+	wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_MINIMIZED);
+	wl_display_flush(wayland_display);
+}
+
+// Toplevel state bits from the last configure, written by the loop thread
+static bool
+window_wayland_state(window_t* window, unsigned int state) {
+	mutex_lock(wayland_mutex);
+	bool set = (window->configure_state & (1U << state)) != 0;
+	mutex_unlock(wayland_mutex);
+	return set;
+}
+
+void
+window_wayland_restore(window_t* window) {
+	// There is no unminimize request in xdg-shell, a minimized surface is restored by the compositor
+	if (window_wayland_state(window, XDG_TOPLEVEL_STATE_MAXIMIZED)) {
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_UNSET_MAXIMIZED);
+		wl_display_flush(wayland_display);
+	}
+}
+
+bool
+window_wayland_is_maximized(window_t* window) {
+	return window_wayland_state(window, XDG_TOPLEVEL_STATE_MAXIMIZED);
+}
+
+void
+window_wayland_set_fullscreen(window_t* window, bool fullscreen) {
+	// No output, the compositor picks the output the surface is on. Fullscreen surfaces are scanned out
+	// directly by compositors supporting it, there is no separate bypass hint
+	if (fullscreen)
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_FULLSCREEN, nullptr);
+	else
+		wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_UNSET_FULLSCREEN);
+	wl_display_flush(wayland_display);
+}
+
+bool
+window_wayland_is_fullscreen(window_t* window) {
+	return window_wayland_state(window, XDG_TOPLEVEL_STATE_FULLSCREEN);
+}
+
+void
+window_wayland_resize(window_t* window, int width, int height) {
+	// Floating toplevels pick their own size, so apply it through the same path as a configure
+	mutex_lock(wayland_mutex);
+	window->configure_width = width;
+	window->configure_height = height;
+	mutex_unlock(wayland_mutex);
+	window_wayland_restore(window);
+	if (write(wayland_wake[1], "r", 1) < 0)
+		log_warn(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Unable to wake Wayland message loop"));
+}
+
+void*
+window_wayland_surface(window_t* window) {
+	mutex_lock(wayland_mutex);
+	window->wl_external = true;
+	mutex_unlock(wayland_mutex);
+	return window->wl_surface;
+}
+
+size_t
+window_wayland_monitors(window_monitor_t* monitors, size_t capacity) {
+	mutex_lock(wayland_mutex);
+	size_t count = array_size(wayland_output_list);
+	for (size_t iout = 0; (iout < count) && (iout < capacity); ++iout) {
+		monitors[iout] = wayland_output_list[iout].monitor;
+		// Wayland has no primary output, the first one advertised is reported as primary
+		monitors[iout].primary = (iout == 0) ? 1 : 0;
+	}
+	mutex_unlock(wayland_mutex);
+	return count;
+}
+
+void
+window_wayland_set_title(window_t* window, const char* title, size_t length) {
+	char buffer[256];
+	string_t str = string_copy(buffer, sizeof(buffer), title, length);
+	wl_proxy_marshal(window->xdg_toplevel, XDG_TOPLEVEL_SET_TITLE, str.str);
+	wl_display_flush(wayland_display);
+}
+
+static int
+window_wayland_dispatch(void) {
+	mutex_lock(wayland_mutex);
+	int ret = wl_display_dispatch_pending(wayland_display);
+	mutex_unlock(wayland_mutex);
+	return ret;
+}
+
+// Protocol errors and lost connections are fatal for the display, the loop stops
+static int
+window_wayland_error(void) {
+	int error = wl_display_get_error(wayland_display);
+	string_const_t errmsg = system_error_message(error);
+	log_errorf(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Lost connection to Wayland display: %.*s (%d)"),
+	           STRING_FORMAT(errmsg), error);
+	return -1;
+}
+
+int
+window_wayland_message_loop(void) {
+	int fd = wl_display_get_fd(wayland_display);
+	wayland_exit_loop = false;
+	while (!wayland_exit_loop) {
+		while (wl_display_prepare_read(wayland_display) != 0) {
+			if (window_wayland_dispatch() < 0)
+				return window_wayland_error();
+		}
+		wl_display_flush(wayland_display);
+
+		struct pollfd fds[2] = {{fd, POLLIN, 0}, {wayland_wake[0], POLLIN, 0}};
+		if (poll(fds, 2, -1) < 0) {
+			wl_display_cancel_read(wayland_display);
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			if (wl_display_read_events(wayland_display) < 0)
+				return window_wayland_error();
+		} else {
+			wl_display_cancel_read(wayland_display);
+		}
+		if (fds[0].revents & (POLLERR | POLLHUP)) {
+			log_error(HASH_WINDOW, ERROR_SYSTEM_CALL_FAIL, STRING_CONST("Lost connection to Wayland display"));
+			return -1;
+		}
+		if (fds[1].revents & POLLIN) {
+			char drain[64];
+			while (read(wayland_wake[0], drain, sizeof(drain)) > 0) {
+			}
+		}
+
+		// Configures received during this dispatch are coalesced into one ack, buffer and RESIZE
+		mutex_lock(wayland_mutex);
+		if (wl_display_dispatch_pending(wayland_display) < 0) {
+			mutex_unlock(wayland_mutex);
+			return window_wayland_error();
+		}
+		for (size_t iwin = 0, wsize = array_size(wayland_window_list); iwin < wsize; ++iwin) {
+			window_t* window = wayland_window_list[iwin];
+			bool manual = window->visible && window->configure_width &&
+			              ((window->configure_width != window->width) || (window->configure_height != window->height));
+			if (window->configure_pending || manual)
+				window_wayland_apply_configure(window);
+		}
+		mutex_unlock(wayland_mutex);
+
+		window_event_dispatch_deferred();
+		window_event_backpressure();
+		++window_event_token;
+	}
+	wl_display_flush(wayland_display);
+	return 0;
+}
+
+void
+window_wayland_message_quit(void) {
+	wayland_exit_loop = true;
+	if (write(wayland_wake[1], "q", 1) < 0)
+		log_warn(HASH_WINDOW, WARNING_SYSTEM_CALL_FAIL, STRING_CONST("Unable to wake Wayland message loop"));
+}
+
+#endif
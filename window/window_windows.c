@@ -160,6 +160,9 @@ window_create(window_t* window, unsigned int adapter, const char* title, size_t
 	WNDCLASSW wc;
 	RECT rect;
 
+	// A window set up by window_allocate or window_initialize already holds a handle. Release only
+	// frees a slot that still refers to this window, so uninitialized storage is safe
+	window_handle_release(window);
 	memset(window, 0, sizeof(window_t));
 	window->instance = GetModuleHandle(0);
 	window->created = true;
@@ -167,6 +170,7 @@ window_create(window_t* window, unsigned int adapter, const char* title, size_t
 	window->last_paint = -1;
 	window->last_resize = -1;
 	window->flags = flags;
+	window_handle_acquire(window);
 
 	do {
 		static atomic32_t counter = {0};
@@ -303,7 +307,7 @@ window_create(window_t* window, unsigned int adapter, const char* title, size_t
 
 window_t*
 window_allocate(void* hwnd) {
-	window_t* window = memory_allocate(HASH_WINDOW, sizeof(window_t), 0, MEMORY_PERSISTENT | MEMORY_ZERO_INITIALIZED);
+	window_t* window = window_pool_allocate();
 	window_initialize(window, hwnd);
 	return window;
 }
@@ -317,6 +321,7 @@ window_initialize(window_t* window, void* hwnd) {
 	window->hwnd = hwnd;
 	window->last_paint = -1;
 	window->last_resize = -1;
+	window_handle_acquire(window);
 }
 
 void*
@@ -364,12 +369,13 @@ window_finalize(window_t* window) {
 		if (hwnd)
 			DestroyWindow((HWND)hwnd);
 	}
+	window_handle_release(window);
 }
 
 void
 window_deallocate(window_t* window) {
 	window_finalize(window);
-	memory_deallocate(window);
+	window_pool_deallocate(window);
 }
 
 unsigned int